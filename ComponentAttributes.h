@@ -0,0 +1,134 @@
+#ifndef IMAGEPROCESSING_COMPONENT_ATTRIBUTES_H__
+#define IMAGEPROCESSING_COMPONENT_ATTRIBUTES_H__
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include <util/point.hpp>
+#include <util/box.hpp>
+
+/**
+ * Attributes of a connected component that can be accumulated incrementally
+ * while parsing an image: The parsers add the pixels of a component that are
+ * not part of any child component and merge the attributes of the children
+ * when the component is finalized. This way, the attributes of all components
+ * are computed in time linear in the number of pixels.
+ */
+class ComponentAttributes {
+
+public:
+
+	ComponentAttributes() :
+		_size(0),
+		_minX(std::numeric_limits<unsigned int>::max()),
+		_minY(std::numeric_limits<unsigned int>::max()),
+		_maxX(0),
+		_maxY(0),
+		_sumX(0),
+		_sumY(0),
+		_sumXX(0),
+		_sumXY(0),
+		_sumYY(0),
+		_sumLevels(0) {}
+
+	/**
+	 * Add a pixel with the given (discretized) level.
+	 */
+	inline void add(unsigned int x, unsigned int y, uint64_t level) {
+
+		_size++;
+
+		_minX = std::min(_minX, x);
+		_minY = std::min(_minY, y);
+		_maxX = std::max(_maxX, x);
+		_maxY = std::max(_maxY, y);
+
+		_sumX  += x;
+		_sumY  += y;
+		_sumXX += static_cast<uint64_t>(x)*x;
+		_sumXY += static_cast<uint64_t>(x)*y;
+		_sumYY += static_cast<uint64_t>(y)*y;
+
+		_sumLevels += level;
+	}
+
+	/**
+	 * Add the attributes of a disjoint component, e.g., a child.
+	 */
+	inline void merge(const ComponentAttributes& other) {
+
+		_size += other._size;
+
+		_minX = std::min(_minX, other._minX);
+		_minY = std::min(_minY, other._minY);
+		_maxX = std::max(_maxX, other._maxX);
+		_maxY = std::max(_maxY, other._maxY);
+
+		_sumX  += other._sumX;
+		_sumY  += other._sumY;
+		_sumXX += other._sumXX;
+		_sumXY += other._sumXY;
+		_sumYY += other._sumYY;
+
+		_sumLevels += other._sumLevels;
+	}
+
+	/**
+	 * The number of pixels.
+	 */
+	uint64_t getSize() const { return _size; }
+
+	/**
+	 * The bounding box of the pixels, in the same format as
+	 * ConnectedComponent::getBoundingBox().
+	 */
+	util::box<int,2> getBoundingBox() const {
+
+		if (_size == 0)
+			return util::box<int,2>(0, 0, 0, 0);
+
+		return util::box<int,2>(_minX, _minY, _maxX + 1, _maxY + 1);
+	}
+
+	/**
+	 * The mean pixel location.
+	 */
+	util::point<double,2> getCenter() const {
+
+		util::point<double,2> center(_sumX, _sumY);
+		center /= _size;
+
+		return center;
+	}
+
+	/**
+	 * The sums of x, y, x*x, x*y, and y*y over all pixels, i.e., the raw first
+	 * and second order moments.
+	 */
+	uint64_t getSumX()  const { return _sumX; }
+	uint64_t getSumY()  const { return _sumY; }
+	uint64_t getSumXX() const { return _sumXX; }
+	uint64_t getSumXY() const { return _sumXY; }
+	uint64_t getSumYY() const { return _sumYY; }
+
+	/**
+	 * The sum of the discretized levels of all pixels.
+	 */
+	uint64_t getSumLevels() const { return _sumLevels; }
+
+private:
+
+	uint64_t _size;
+
+	unsigned int _minX, _minY;
+	unsigned int _maxX, _maxY;
+
+	uint64_t _sumX, _sumY;
+	uint64_t _sumXX, _sumXY, _sumYY;
+
+	uint64_t _sumLevels;
+};
+
+#endif // IMAGEPROCESSING_COMPONENT_ATTRIBUTES_H__
+
@@ -51,8 +51,8 @@ ComponentTree::Node::setComponent(boost::shared_ptr<ConnectedComponent> componen
 	_component = component;
 }
 
-boost::shared_ptr<ConnectedComponent>
-ComponentTree::Node::getComponent() {
+const boost::shared_ptr<ConnectedComponent>&
+ComponentTree::Node::getComponent() const {
 
 	return _component;
 }
@@ -64,6 +64,7 @@ void
 ComponentTree::clear() {
 
 	_root.reset();
+	_flatTree.reset();
 	_boundingBox = util::box<double,2>(0, 0, 0, 0);
 }
 
@@ -71,34 +72,115 @@ void
 ComponentTree::setRoot(boost::shared_ptr<ComponentTree::Node> root) {
 
 	_root = root;
+	_flatTree.reset();
 	updateBoundingBox();
 }
 
+void
+ComponentTree::setFlatTree(boost::shared_ptr<FlatComponentTree> tree) {
+
+	_root.reset();
+	_flatTree = tree;
+	updateBoundingBox();
+}
+
+boost::shared_ptr<FlatComponentTree>
+ComponentTree::getFlatTree() {
+
+	return _flatTree;
+}
+
 boost::shared_ptr<ComponentTree::Node>
 ComponentTree::getRoot() {
 
+	if (!_root && _flatTree && !_flatTree->empty())
+		_root = createNodes();
+
 	return _root;
 }
 
 unsigned int
 ComponentTree::size() const {
 
+	if (!_root && _flatTree)
+		return _flatTree->size();
+
 	return count(_root);
 }
 
 unsigned int
-ComponentTree::count(boost::shared_ptr<ComponentTree::Node> node) const {
+ComponentTree::count(const boost::shared_ptr<ComponentTree::Node>& node) const {
+
+	unsigned int numNodes = 0;
 
-	int numNodes = 0;
+	std::vector<const Node*> stack(1, node.get());
 
-	for (boost::shared_ptr<ComponentTree::Node> child : node->getChildren())
-		numNodes += count(child);
+	while (!stack.empty()) {
 
-	numNodes++;
+		const Node* current = stack.back();
+		stack.pop_back();
+
+		numNodes++;
+
+		for (const boost::shared_ptr<Node>& child : current->getChildren())
+			stack.push_back(child.get());
+	}
 
 	return numNodes;
 }
 
+void
+ComponentTree::split(
+		const boost::shared_ptr<Node>& node,
+		size_t                         numSubtrees,
+		std::vector<upper_node_type>&  upper,
+		std::vector<subtree_type>&     subtrees,
+		unsigned int&                  depth) const {
+
+	upper.clear();
+	subtrees.assign(1, subtree_type(0, &node));
+	depth = 0;
+
+	std::vector<subtree_type> next;
+
+	// replace the subtrees by the subtrees of their children, level by 
+	// level, until there are enough
+	while (subtrees.size() < numSubtrees) {
+
+		next.clear();
+
+		bool expanded = false;
+
+		for (std::vector<subtree_type>::const_iterator i = subtrees.begin(); i != subtrees.end(); i++) {
+
+			const std::vector<boost::shared_ptr<Node> >& children = (*i->second)->getChildren();
+
+			if (children.empty()) {
+
+				next.push_back(*i);
+				continue;
+			}
+
+			upper.push_back(upper_node_type(i->second, depth));
+			expanded = true;
+
+			for (const boost::shared_ptr<Node>& child : children)
+				next.push_back(subtree_type(i->second, &child));
+		}
+
+		// all subtrees are leaves
+		if (!expanded)
+			break;
+
+		subtrees.swap(next);
+		depth++;
+	}
+
+	LOG_ALL(componenttreelog)
+			<< "split tree into " << upper.size() << " upper nodes and "
+			<< subtrees.size() << " subtrees" << std::endl;
+}
+
 const util::box<double,2>&
 ComponentTree::getBoundingBox() const {
 
@@ -114,25 +196,37 @@ ComponentTree::getBoundingBox() const {
 ComponentTree
 ComponentTree::clone() {
 
-	boost::shared_ptr<ComponentTree::Node> root = clone(_root);
-
 	ComponentTree tree;
 
-	tree.setRoot(_root);
+	if (getRoot())
+		tree.setRoot(clone(getRoot()));
 
 	return tree;
 }
 
 boost::shared_ptr<ComponentTree::Node>
-ComponentTree::clone(boost::shared_ptr<ComponentTree::Node> node) {
+ComponentTree::clone(const boost::shared_ptr<ComponentTree::Node>& node) {
 
 	boost::shared_ptr<ComponentTree::Node> nodeClone = boost::make_shared<ComponentTree::Node>(node->getComponent());
 
-	for (boost::shared_ptr<ComponentTree::Node> child : node->getChildren()) {
+	// the nodes whose children are to be cloned, with their clones
+	std::vector<std::pair<Node*, boost::shared_ptr<Node> > > stack(1, std::make_pair(node.get(), nodeClone));
+
+	while (!stack.empty()) {
+
+		Node*                   original = stack.back().first;
+		boost::shared_ptr<Node> copy     = stack.back().second;
+		stack.pop_back();
 
-		boost::shared_ptr<ComponentTree::Node> childClone = clone(child);
+		for (const boost::shared_ptr<Node>& child : original->getChildren()) {
 
-		nodeClone->addChild(childClone);
+			boost::shared_ptr<Node> childClone = boost::make_shared<ComponentTree::Node>(child->getComponent());
+
+			childClone->setParent(copy);
+			copy->addChild(childClone);
+
+			stack.push_back(std::make_pair(child.get(), childClone));
+		}
 	}
 
 	return nodeClone;
@@ -141,22 +235,86 @@ ComponentTree::clone(boost::shared_ptr<ComponentTree::Node> node) {
 void
 ComponentTree::updateBoundingBox() {
 
-	_boundingBox = updateBoundingBox(_root);
+	if (!_flatTree) {
+
+		_boundingBox = updateBoundingBox(_root);
+		return;
+	}
+
+	_boundingBox = util::box<double,2>(0, 0, 0, 0);
+
+	for (FlatComponentTree::node_type node = 0; node < _flatTree->size(); node++) {
+
+		const util::box<int,2>& boundingBox = _flatTree->getBoundingBox(node);
+
+		if (node == 0) {
+
+			_boundingBox = boundingBox;
+			continue;
+		}
+
+		_boundingBox.min().x() = std::min(_boundingBox.min().x(), (double)boundingBox.min().x());
+		_boundingBox.max().x() = std::max(_boundingBox.max().x(), (double)boundingBox.max().x());
+		_boundingBox.min().y() = std::min(_boundingBox.min().y(), (double)boundingBox.min().y());
+		_boundingBox.max().y() = std::max(_boundingBox.max().y(), (double)boundingBox.max().y());
+	}
+}
+
+boost::shared_ptr<ComponentTree::Node>
+ComponentTree::createNodes() {
+
+	LOG_DEBUG(componenttreelog)
+			<< "creating " << _flatTree->size() << " nodes of flat tree" << std::endl;
+
+	// nodes that have been created, but not been added to their parent yet
+	std::vector<boost::shared_ptr<Node> > nodes(_flatTree->size());
+
+	// the children of each node precede it
+	for (FlatComponentTree::node_type node = 0; node < _flatTree->size(); node++) {
+
+		nodes[node] = boost::make_shared<Node>(
+				boost::make_shared<ConnectedComponent>(
+						_flatTree->getValue(node),
+						_flatTree->getPixelList(),
+						_flatTree->beginPixels(node),
+						_flatTree->endPixels(node),
+						_flatTree->getBoundingBox(node),
+						_flatTree->getCenter(node)));
+
+		for (FlatComponentTree::child_iterator child = _flatTree->beginChildren(node); child != _flatTree->endChildren(node); child++) {
+
+			nodes[node]->addChild(nodes[*child]);
+			nodes[*child]->setParent(nodes[node]);
+			nodes[*child].reset();
+		}
+	}
+
+	return nodes[_flatTree->getRoot()];
 }
 
 util::box<double,2>
-ComponentTree::updateBoundingBox(boost::shared_ptr<ComponentTree::Node> node) {
+ComponentTree::updateBoundingBox(const boost::shared_ptr<ComponentTree::Node>& node) {
 
 	util::box<double,2> boundingBox = node->getComponent()->getBoundingBox();
 
-	for (boost::shared_ptr<ComponentTree::Node> child : node->getChildren()) {
+	std::vector<const Node*> stack(1, node.get());
+
+	while (!stack.empty()) {
+
+		const Node* current = stack.back();
+		stack.pop_back();
+
+		for (const boost::shared_ptr<Node>& child : current->getChildren()) {
+
+			const util::box<double,2>& childBoundingBox = child->getComponent()->getBoundingBox();
 
-		util::box<double,2> childBoundingBox = updateBoundingBox(child);
+			boundingBox.min().x() = std::min(boundingBox.min().x(), childBoundingBox.min().x());
+			boundingBox.max().x() = std::max(boundingBox.max().x(), childBoundingBox.max().x());
+			boundingBox.min().y() = std::min(boundingBox.min().y(), childBoundingBox.min().y());
+			boundingBox.max().y() = std::max(boundingBox.max().y(), childBoundingBox.max().y());
 
-		boundingBox.min().x() = std::min(boundingBox.min().x(), childBoundingBox.min().x());
-		boundingBox.max().x() = std::max(boundingBox.max().x(), childBoundingBox.max().x());
-		boundingBox.min().y() = std::min(boundingBox.min().y(), childBoundingBox.min().y());
-		boundingBox.max().y() = std::max(boundingBox.max().y(), childBoundingBox.max().y());
+			stack.push_back(child.get());
+		}
 	}
 
 	return boundingBox;
@@ -1,7 +1,12 @@
 #ifndef IMAGEPROCESSING_COMPONENT_TREE_H__
 #define IMAGEPROCESSING_COMPONENT_TREE_H__
 
+#include <vector>
+#include <type_traits>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 #include <imageprocessing/ConnectedComponent.h>
+#include <imageprocessing/FlatComponentTree.h>
 #include <util/foreach.h>
 #include <util/Logger.h>
 #include <util/box.hpp>
@@ -9,6 +14,13 @@
 
 static logger::LogChannel componenttreelog("componenttreelog", "[ComponentTree] ");
 
+/**
+ * A tree of connected components. The tree can either be assembled from 
+ * nodes, or be given as a FlatComponentTree. In the latter case, the nodes 
+ * are only created when they are accessed for the first time (through 
+ * getRoot() or visit()), such that code that uses the flat tree directly does 
+ * not have to pay for them.
+ */
 class ComponentTree : public pipeline::Data {
 
 public:
@@ -86,7 +98,7 @@ public:
 		 *
 		 * @return The connected component help by this node.
 		 */
-		boost::shared_ptr<ConnectedComponent> getComponent();
+		const boost::shared_ptr<ConnectedComponent>& getComponent() const;
 
 	private:
 
@@ -106,12 +118,22 @@ public:
 
 	public:
 
-		void visitNode(boost::shared_ptr<Node>) {};
-		void visitEdge(boost::shared_ptr<Node>, boost::shared_ptr<Node>) {};
-		void leaveNode(boost::shared_ptr<Node>) {};
-		void leaveEdge(boost::shared_ptr<Node>, boost::shared_ptr<Node>) {};
+		void visitNode(const boost::shared_ptr<Node>&) {};
+		void visitEdge(const boost::shared_ptr<Node>&, const boost::shared_ptr<Node>&) {};
+		void leaveNode(const boost::shared_ptr<Node>&) {};
+		void leaveEdge(const boost::shared_ptr<Node>&, const boost::shared_ptr<Node>&) {};
 	};
 
+	/**
+	 * Base class for visitors whose callbacks can be called concurrently. 
+	 * Trees are visited by several threads for such visitors, each visiting 
+	 * different subtrees. The callbacks of each node are still ordered with 
+	 * respect to its ancestors and descendants (visitNode() and visitEdge() 
+	 * before, leaveNode() and leaveEdge() after), but not with respect to 
+	 * other nodes.
+	 */
+	class ThreadSafeVisitor : public Visitor {};
+
 	/**
 	 * Default constructor.
 	 */
@@ -129,6 +151,21 @@ public:
 	 */
 	void setRoot(boost::shared_ptr<Node> root);
 
+	/**
+	 * Replace the tree by a flat tree.
+	 *
+	 * @param tree The new flat tree.
+	 */
+	void setFlatTree(boost::shared_ptr<FlatComponentTree> tree);
+
+	/**
+	 * Get the flat tree, if this tree was set from one.
+	 *
+	 * @return The flat tree, or an empty pointer if the tree was assembled 
+	 *         from nodes.
+	 */
+	boost::shared_ptr<FlatComponentTree> getFlatTree();
+
 	/**
 	 * Get the root node of the tree.
 	 *
@@ -146,41 +183,47 @@ public:
 	/**
 	 * Visit each node and edge in the tree. This method performs a
 	 * depth-first-search on the tree. The argument type has to model Visitor
-	 * (see the default implementation above).
+	 * (see the default implementation above). Visitors derived from 
+	 * ThreadSafeVisitor are called from several threads.
 	 *
 	 * @param visitor A callback class for visiting nodes and edges.
 	 */
 	template <class Visitor>
 	void visit(Visitor& visitor) {
 
-		visit(_root, visitor);
+		visit(getRoot(), visitor);
 	}
 
 	/**
 	 * Visit each node below (and including) the given node. This method
 	 * performs a depth-first-search on the tree. The argument type has to
-	 * model Visitor (see the default implementation above).
+	 * model Visitor (see the default implementation above). Visitors derived 
+	 * from ThreadSafeVisitor are called from several threads.
 	 *
 	 * @param node The starting node.
 	 * @param visitor A callback class for visiting nodes and edges.
 	 */
 	template <class Visitor>
-	void visit(boost::shared_ptr<Node> node, Visitor& visitor) {
-
-		visitor.visitNode(node);
+	void visit(const boost::shared_ptr<Node>& node, Visitor& visitor) {
 
-		for (boost::shared_ptr<Node> child : node->getChildren()) {
-
-			visitor.visitEdge(node, child);
-
-			visit(child, visitor);
-
-			visitor.leaveEdge(node, child);
-		}
-
-		visitor.leaveNode(node);
+		if (std::is_base_of<ThreadSafeVisitor, Visitor>::value)
+			visitParallel(node, visitor, boost::thread::hardware_concurrency());
+		else
+			visitSubtree(node, visitor);
 	}
 
+	/**
+	 * Visit each node below (and including) the given node with the given 
+	 * number of threads. The visitor has to be thread-safe (see 
+	 * ThreadSafeVisitor).
+	 *
+	 * @param node The starting node.
+	 * @param visitor A callback class for visiting nodes and edges.
+	 * @param numThreads The number of threads to use.
+	 */
+	template <class VisitorType>
+	void visitParallel(const boost::shared_ptr<Node>& node, VisitorType& visitor, unsigned int numThreads);
+
 	/**
 	 * Get the bounding box of all components in the component tree.
 	 *
@@ -198,18 +241,217 @@ public:
 
 private:
 
-	unsigned int count(boost::shared_ptr<ComponentTree::Node> node) const;
+	// a node in the upper part of a tree that is visited in parallel, or the 
+	// root of a subtree below, with the depth or parent
+	typedef std::pair<const boost::shared_ptr<Node>*, unsigned int>             upper_node_type;
+	typedef std::pair<const boost::shared_ptr<Node>*, const boost::shared_ptr<Node>*> subtree_type;
 
-	boost::shared_ptr<Node> clone(boost::shared_ptr<Node> node);
+	/**
+	 * Visit the subtree of the given node with an explicit stack, in the 
+	 * calling thread.
+	 */
+	template <class VisitorType>
+	void visitSubtree(const boost::shared_ptr<Node>& node, VisitorType& visitor);
+
+	/**
+	 * Visit the subtrees in 'subtrees', starting with the next one, until 
+	 * there are none left. Invoked by each thread of visitParallel().
+	 */
+	template <class VisitorType>
+	void visitSubtrees(
+			const std::vector<subtree_type>& subtrees,
+			size_t&                          next,
+			VisitorType&                     visitor,
+			boost::exception_ptr&            exception,
+			boost::mutex&                    mutex);
+
+	/**
+	 * Split the tree below the given node into an upper part and at least 
+	 * 'numSubtrees' subtrees below it (if there are enough nodes). The upper 
+	 * part is found level by level and consists of all nodes with children 
+	 * above the given depth, in breadth-first order.
+	 */
+	void split(
+			const boost::shared_ptr<Node>& node,
+			size_t                         numSubtrees,
+			std::vector<upper_node_type>&  upper,
+			std::vector<subtree_type>&     subtrees,
+			unsigned int&                  depth) const;
+
+	unsigned int count(const boost::shared_ptr<ComponentTree::Node>& node) const;
+
+	boost::shared_ptr<Node> clone(const boost::shared_ptr<Node>& node);
+
+	/**
+	 * Create the nodes of the flat tree.
+	 */
+	boost::shared_ptr<Node> createNodes();
 
 	void updateBoundingBox();
 
-	util::box<double,2> updateBoundingBox(boost::shared_ptr<Node> node);
+	util::box<double,2> updateBoundingBox(const boost::shared_ptr<Node>& node);
 
 	boost::shared_ptr<Node> _root;
 
+	// the flat tree, if the tree was set from one (_root is then created on 
+	// demand)
+	boost::shared_ptr<FlatComponentTree> _flatTree;
+
 	util::box<double,2> _boundingBox;
 };
 
+template <class VisitorType>
+void
+ComponentTree::visitParallel(const boost::shared_ptr<Node>& node, VisitorType& visitor, unsigned int numThreads) {
+
+	if (numThreads <= 1) {
+
+		visitSubtree(node, visitor);
+		return;
+	}
+
+	// split the tree into more subtrees than threads, to balance the work
+	std::vector<upper_node_type> upper;
+	std::vector<subtree_type>    subtrees;
+	unsigned int                 depth;
+
+	split(node, 4*numThreads, upper, subtrees, depth);
+
+	if (subtrees.size() <= 1) {
+
+		visitSubtree(node, visitor);
+		return;
+	}
+
+	// the children of upper nodes are upper nodes as well, if they have 
+	// children and are above the depth of the split
+
+	for (typename std::vector<upper_node_type>::const_iterator i = upper.begin(); i != upper.end(); i++) {
+
+		visitor.visitNode(*i->first);
+
+		if (i->second + 1 < depth)
+			for (const boost::shared_ptr<Node>& child : (*i->first)->getChildren())
+				if (!child->getChildren().empty())
+					visitor.visitEdge(*i->first, child);
+	}
+
+	size_t               next = 0;
+	boost::exception_ptr exception;
+	boost::mutex         mutex;
+
+	boost::thread_group workers;
+
+	for (unsigned int i = 0; i < std::min(static_cast<size_t>(numThreads), subtrees.size()); i++)
+		workers.add_thread(
+				new boost::thread(
+						&ComponentTree::visitSubtrees<VisitorType>,
+						this,
+						boost::cref(subtrees),
+						boost::ref(next),
+						boost::ref(visitor),
+						boost::ref(exception),
+						boost::ref(mutex)));
+
+	workers.join_all();
+
+	if (exception)
+		boost::rethrow_exception(exception);
+
+	for (typename std::vector<upper_node_type>::const_reverse_iterator i = upper.rbegin(); i != upper.rend(); i++) {
+
+		const std::vector<boost::shared_ptr<Node> >& children = (*i->first)->getChildren();
+
+		if (i->second + 1 < depth)
+			for (typename std::vector<boost::shared_ptr<Node> >::const_reverse_iterator child = children.rbegin(); child != children.rend(); child++)
+				if (!(*child)->getChildren().empty())
+					visitor.leaveEdge(*i->first, *child);
+
+		visitor.leaveNode(*i->first);
+	}
+}
+
+template <class VisitorType>
+void
+ComponentTree::visitSubtree(const boost::shared_ptr<Node>& node, VisitorType& visitor) {
+
+	// the nodes on the current path, with the index of their next child
+	std::vector<std::pair<const boost::shared_ptr<Node>*, size_t> > stack;
+
+	visitor.visitNode(node);
+	stack.push_back(std::make_pair(&node, 0));
+
+	while (!stack.empty()) {
+
+		const boost::shared_ptr<Node>&               parent   = *stack.back().first;
+		const std::vector<boost::shared_ptr<Node> >& children = parent->getChildren();
+
+		if (stack.back().second == children.size()) {
+
+			visitor.leaveNode(parent);
+			stack.pop_back();
+
+			if (!stack.empty())
+				visitor.leaveEdge(*stack.back().first, parent);
+
+			continue;
+		}
+
+		const boost::shared_ptr<Node>& child = children[stack.back().second];
+		stack.back().second++;
+
+		visitor.visitEdge(parent, child);
+		visitor.visitNode(child);
+
+		stack.push_back(std::make_pair(&child, 0));
+	}
+}
+
+template <class VisitorType>
+void
+ComponentTree::visitSubtrees(
+		const std::vector<subtree_type>& subtrees,
+		size_t&                          next,
+		VisitorType&                     visitor,
+		boost::exception_ptr&            exception,
+		boost::mutex&                    mutex) {
+
+	while (true) {
+
+		size_t subtree;
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+
+			if (next == subtrees.size() || exception)
+				return;
+
+			subtree = next;
+			next++;
+		}
+
+		const boost::shared_ptr<Node>* parent = subtrees[subtree].first;
+		const boost::shared_ptr<Node>& node   = *subtrees[subtree].second;
+
+		try {
+
+			if (parent)
+				visitor.visitEdge(*parent, node);
+
+			visitSubtree(node, visitor);
+
+			if (parent)
+				visitor.leaveEdge(*parent, node);
+
+		} catch (...) {
+
+			boost::mutex::scoped_lock lock(mutex);
+
+			if (!exception)
+				exception = boost::current_exception();
+		}
+	}
+}
+
 #endif // IMAGEPROCESSING_COMPONENT_TREE_H__
 
@@ -22,6 +22,14 @@ ComponentTreeDownSampler::updateOutputs() {
 void
 ComponentTreeDownSampler::downsample() {
 
+	boost::shared_ptr<FlatComponentTree> flatTree = _componentTree->getFlatTree();
+
+	if (flatTree) {
+
+		_downsampled->setFlatTree(downsample(flatTree));
+		return;
+	}
+
 	boost::shared_ptr<ComponentTree::Node> rootNode = _componentTree->getRoot();
 
 	// create a clone of the root node
@@ -40,6 +48,37 @@ ComponentTreeDownSampler::downsample() {
 	_downsampled->setRoot(rootNodeClone);
 }
 
+boost::shared_ptr<FlatComponentTree>
+ComponentTreeDownSampler::downsample(boost::shared_ptr<FlatComponentTree> tree) {
+
+	typedef FlatComponentTree::node_type node_type;
+
+	if (tree->empty())
+		return tree;
+
+	const node_type root = tree->getRoot();
+
+	// a node is skipped if it is the single child of a node other than the 
+	// root
+	std::vector<bool> keep(tree->size());
+	for (node_type node = 0; node < root; node++) {
+
+		node_type parent = tree->getParent(node);
+
+		keep[node] = (parent == root || tree->getNumChildren(parent) != 1);
+	}
+
+	keep[root] = true;
+
+	boost::shared_ptr<FlatComponentTree> downsampled = tree->filter(keep);
+
+	LOG_DEBUG(componenttreedownsamplerlog)
+			<< "kept " << downsampled->size() << " of " << tree->size()
+			<< " components" << std::endl;
+
+	return downsampled;
+}
+
 boost::shared_ptr<ComponentTree::Node>
 ComponentTreeDownSampler::downsample(boost::shared_ptr<ComponentTree::Node> node) {
 
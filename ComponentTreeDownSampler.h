@@ -4,6 +4,14 @@
 #include <pipeline/all.h>
 #include <imageprocessing/ComponentTree.h>
 
+/**
+ * Removes chains of nodes with single children from a component tree: Of each 
+ * chain, only the first node is kept (with the children of the last node of 
+ * the chain). The children of the root are always kept.
+ *
+ * Component trees that are given as flat trees are downsampled on the flat 
+ * tree in linear passes over the nodes, without creating nodes.
+ */
 class ComponentTreeDownSampler : public pipeline::SimpleProcessNode<> {
 
 public:
@@ -16,6 +24,11 @@ private:
 
 	void downsample();
 
+	/**
+	 * Downsample a flat component tree.
+	 */
+	boost::shared_ptr<FlatComponentTree> downsample(boost::shared_ptr<FlatComponentTree> tree);
+
 	boost::shared_ptr<ComponentTree::Node> downsample(boost::shared_ptr<ComponentTree::Node> node);
 
 	pipeline::Input<ComponentTree>  _componentTree;
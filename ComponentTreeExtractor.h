@@ -1,8 +1,18 @@
 #ifndef IMAGEPROCESSING_COMPNENT_TREE_EXTRACTOR_H__
 #define IMAGEPROCESSING_COMPNENT_TREE_EXTRACTOR_H__
 
+#include <cmath>
+#include <limits>
+#include <boost/thread/tss.hpp>
 #include <pipeline/SimpleProcessNode.h>
+#include <pipeline/Value.h>
+#include <util/box.hpp>
 #include <imageprocessing/ImageLevelParser.h>
+#include <imageprocessing/UnionFindParser.h>
+#include <imageprocessing/StreamingLevelParser.h>
+#include <imageprocessing/SameIntensityParser.h>
+#include <imageprocessing/io/ImageBlockFactory.h>
+#include <imageprocessing/io/ComponentTreeCache.h>
 #include "ComponentTree.h"
 #include "ComponentTreeExtractorParameters.h"
 #include "Image.h"
@@ -24,39 +34,45 @@ private:
 	public:
 
 		ComponentVisitor(
-				boost::shared_ptr<ImageType> image,
+				size_t                       imageSize,
 				unsigned int                 minSize,
 				unsigned int                 maxSize,
 				bool                         spacedEdgeImage) :
-			_image(image),
+			_imageSize(imageSize),
+			_tree(boost::make_shared<FlatComponentTree>()),
 			_minSize(minSize),
 			_maxSize(maxSize),
 			_spacedEdgeImage(spacedEdgeImage) {}
 
-		void setPixelList(boost::shared_ptr<PixelList> pixelList) { _pixelList = pixelList; }
+		void setPixelList(boost::shared_ptr<PixelList> pixelList) {
+
+			_tree->clear(pixelList);
+		}
 
 		inline void finalizeComponent(
 				const typename ImageType::value_type value,
 				PixelList::const_iterator            begin,
-				PixelList::const_iterator            end);
-
-		boost::shared_ptr<ComponentTree::Node> getRoot();
+				PixelList::const_iterator            end,
+				const ComponentAttributes&           attributes);
 
-	private:
+		boost::shared_ptr<FlatComponentTree> getTree() {
 
-		// is the first range contained in the second?
-		inline bool contained(
-				const ConnectedComponent::PixelRange& a,
-				const ConnectedComponent::PixelRange& b) {
+			// the tree is complete after parsing
+			_tree->updateChildren();
 
-			return (a.begin() >= b.begin() && a.end() <= b.end());
+			return _tree;
 		}
 
-		boost::shared_ptr<ImageType> _image;
-		boost::shared_ptr<PixelList> _pixelList;
+	private:
+
+		size_t _imageSize;
+
+		// the tree under construction, with nodes in the order they are 
+		// finalized
+		boost::shared_ptr<FlatComponentTree> _tree;
 
 		// stack of open root nodes while constructing the tree
-		std::stack<boost::shared_ptr<ComponentTree::Node> > _roots;
+		std::stack<FlatComponentTree::node_type> _roots;
 
 		unsigned int _minSize;
 		unsigned int _maxSize;
@@ -70,21 +86,129 @@ private:
 
 	void updateOutputs();
 
+	/**
+	 * Get the key of the parsed tree of the current image and parameters, 
+	 * which covers the image, the edge images (if given), and all parameters 
+	 * that change the parsed tree. Used for the ComponentTreeCache and to 
+	 * reuse unfiltered trees.
+	 */
+	ComponentTreeCache::key_type getCacheKey();
+
+	/**
+	 * Create a tree of the components of the given tree that are within the 
+	 * given size limits (and the whole image), in one pass over the nodes.
+	 */
+	boost::shared_ptr<FlatComponentTree> filterSizes(
+			const FlatComponentTree& tree,
+			unsigned int             minSize,
+			unsigned int             maxSize,
+			size_t                   wholeImageSize);
+
+	/**
+	 * Compute the variation of each node, i.e., the relative growth of its 
+	 * size up to the largest ancestor within delta.
+	 */
+	void computeVariations(
+			const FlatComponentTree& tree,
+			double                   delta,
+			std::vector<double>&     variations);
+
+	/**
+	 * Create a tree of the maximally stable nodes (and the root) of the 
+	 * given unfiltered tree (see ComponentTreeExtractorParameters::mser) 
+	 * that are within the given size limits.
+	 */
+	boost::shared_ptr<FlatComponentTree> getStableTree(
+			const FlatComponentTree& tree,
+			double                   delta,
+			double                   maxVariation,
+			unsigned int             minSize,
+			unsigned int             maxSize,
+			size_t                   wholeImageSize);
+
+	/**
+	 * The size criterion of ComponentVisitor::finalizeComponent().
+	 */
+	static bool isValidSize(
+			size_t       size,
+			unsigned int minSize,
+			unsigned int maxSize,
+			size_t       wholeImageSize) {
+
+		return (size == wholeImageSize || (size >= minSize && (maxSize == 0 || size < maxSize)));
+	}
+
+	/**
+	 * Parse the given image with the parser selected in the parameters.
+	 */
+	void parse(
+			const ImageType& image,
+			const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+			ComponentVisitor& visitor);
+
+	/**
+	 * Extract the flat tree of same intensity components. Images with 
+	 * integral values (e.g., labels) are labelled directly by 
+	 * SameIntensityParser. Other images are parsed after setting the pixels 
+	 * between regions of different intensities to zero.
+	 */
+	void parseSameIntensityComponents(
+			const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+			ComponentVisitor& visitor,
+			std::true_type);
+	void parseSameIntensityComponents(
+			const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+			ComponentVisitor& visitor,
+			std::false_type);
+
+	/**
+	 * Parse the block of the section given by the block input in strips of 
+	 * rows, as read from the block factory.
+	 */
+	void parseStrips(
+			const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+			ComponentVisitor& visitor);
+
+	/**
+	 * Read the given rows of the block from the given reader.
+	 */
+	pipeline::Value<ImageType> readRows(
+			boost::shared_ptr<ImageBlockReader<ImageType> > reader,
+			unsigned int begin,
+			unsigned int end);
+
+	// one parser per thread, kept alive between extractions if the parser 
+	// should be reused
+	static boost::thread_specific_ptr<ImageLevelParser<Precision, ImageType> > _parsers;
+
 	pipeline::Input<ImageType>                        _image;
+	pipeline::Input<ImageType>                        _horizontalEdges;
+	pipeline::Input<ImageType>                        _verticalEdges;
 	pipeline::Input<ComponentTreeExtractorParameters<typename ImageType::value_type> > _parameters;
+	pipeline::Input<ImageBlockFactory<ImageType> >    _blockFactory;
+	pipeline::Input<util::box<unsigned int,3> >       _block;
 	pipeline::Output<ComponentTree>                   _componentTree;
+
+	// the tree before filtering by size, and the key of the image and 
+	// parameters it was parsed from, if the size filter is lazy
+	boost::shared_ptr<FlatComponentTree> _unfilteredTree;
+	ComponentTreeCache::key_type         _unfilteredTreeKey;
 };
 
 ////////////////////
 // IMPLEMENTATION //
 ////////////////////
 
+template <typename Precision, typename ImageType>
+boost::thread_specific_ptr<ImageLevelParser<Precision, ImageType> > ComponentTreeExtractor<Precision, ImageType>::_parsers;
+
 template <typename Precision, typename ImageType>
 void
 ComponentTreeExtractor<Precision, ImageType>::ComponentVisitor::finalizeComponent(
 		const typename ImageType::value_type value,
 		PixelList::const_iterator            begin,
-		PixelList::const_iterator            end) {
+		PixelList::const_iterator            end,
+		const ComponentAttributes&           attributes) {
 
 	bool changed = (begin != _prevBegin || end != _prevEnd);
 
@@ -94,9 +218,9 @@ ComponentTreeExtractor<Precision, ImageType>::ComponentVisitor::finalizeComponen
 	if (!changed)
 		return;
 
-	PixelList::const_iterator::difference_type size = end - begin;
+	size_t size = end - begin;
 
-	bool wholeImage = (size == (_spacedEdgeImage ? _image->size() / 4 : _image->size()));
+	bool wholeImage = (size == (_spacedEdgeImage ? _imageSize / 4 : _imageSize));
 	bool validSize  = (size >= _minSize && (_maxSize == 0 || size < _maxSize));
 
 	// we accept the whole image, even if it is not a valid size, to create a 
@@ -116,21 +240,20 @@ ComponentTreeExtractor<Precision, ImageType>::ComponentVisitor::finalizeComponen
 	ccValue.fill(0);
 	memcpy(ccValue.data(), &value, std::min(sizeof(value), ccValue.size()));
 
-	// create a component tree node
-	boost::shared_ptr<ComponentTree::Node> node
-			= boost::make_shared<ComponentTree::Node>(
-					boost::make_shared<ConnectedComponent>(
-							ccValue,
-							_pixelList,
-							begin,
-							end));
+	// add a component tree node, the parser already accumulated the bounding 
+	// box and center
+	FlatComponentTree::node_type node =
+			_tree->addNode(
+					ccValue,
+					begin,
+					end,
+					attributes.getBoundingBox(),
+					attributes.getCenter());
 
 	// make all open root nodes that are subsets children of this component
-	while (!_roots.empty() && contained(_roots.top()->getComponent()->getPixels(), ConnectedComponent::PixelRange(begin, end))) {
-
-		node->addChild(_roots.top());
-		_roots.top()->setParent(node);
+	while (!_roots.empty() && _tree->beginPixels(_roots.top()) >= begin && _tree->endPixels(_roots.top()) <= end) {
 
+		_tree->setParent(_roots.top(), node);
 		_roots.pop();
 	}
 
@@ -138,19 +261,23 @@ ComponentTreeExtractor<Precision, ImageType>::ComponentVisitor::finalizeComponen
 	_roots.push(node);
 }
 
-template <typename Precision, typename ImageType>
-boost::shared_ptr<ComponentTree::Node>
-ComponentTreeExtractor<Precision, ImageType>::ComponentVisitor::getRoot() {
-
-	return _roots.top();
-}
-
 template <typename Precision, typename ImageType>
 ComponentTreeExtractor<Precision, ImageType>::ComponentTreeExtractor() {
 
-	registerInput(_image, "image");
+	registerInput(_image, "image", pipeline::Optional);
 	registerInput(_parameters, "parameters", pipeline::Optional);
 
+	// optional edges between the pixels of the image, parsed as if they were 
+	// part of a spaced edge image (see ImageLevelParser)
+	registerInput(_horizontalEdges, "horizontal edges", pipeline::Optional);
+	registerInput(_verticalEdges, "vertical edges", pipeline::Optional);
+
+	// instead of an image, a block of a section can be given, which is read 
+	// in strips of rows from the block factory (see 
+	// ComponentTreeExtractorParameters::stripHeight)
+	registerInput(_blockFactory, "block factory", pipeline::Optional);
+	registerInput(_block, "block", pipeline::Optional);
+
 	registerOutput(_componentTree, "component tree");
 }
 
@@ -165,6 +292,13 @@ ComponentTreeExtractor<Precision, ImageType>::updateOutputs() {
 
 	LOG_DEBUG(componenttreeextractorlog) << "starting extraction" << std::endl;
 
+	bool streaming = (_blockFactory.isSet() && _block.isSet());
+
+	if (!streaming && !_image.isSet())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"either an image or a block factory and a block have to be given");
+
 	unsigned int minSize = 0;
 	unsigned int maxSize = 0;
 	bool spacedEdgeImage = false;
@@ -176,8 +310,23 @@ ComponentTreeExtractor<Precision, ImageType>::updateOutputs() {
 		spacedEdgeImage = _parameters->spacedEdgeImage;
 	}
 
-	// create a new visitor
-	ComponentVisitor visitor(_image.getSharedPointer(), minSize, maxSize, spacedEdgeImage);
+	// separate edge images are parsed without upsampling the image, such 
+	// that the components contain the pixels of the image directly
+	if (_horizontalEdges.isSet() && _verticalEdges.isSet())
+		spacedEdgeImage = false;
+
+	typedef std::is_integral<typename ImageType::value_type> labelImage;
+
+	bool sameIntensityComponents = (!streaming && _parameters.isSet() && _parameters->sameIntensityComponents);
+
+	// same intensity components of label images are found on the image 
+	// directly, which can not be a spaced edge image
+	if (sameIntensityComponents && labelImage::value)
+		spacedEdgeImage = false;
+
+	size_t imageSize = (streaming ?
+			static_cast<size_t>(_block->width())*_block->height() :
+			_image->size());
 
 	// create an image level parser
 	typename ImageLevelParser<Precision, ImageType>::Parameters parameters;
@@ -187,42 +336,451 @@ ComponentTreeExtractor<Precision, ImageType>::updateOutputs() {
 		parameters.minIntensity    = _parameters->minIntensity;
 		parameters.maxIntensity    = _parameters->maxIntensity;
 		parameters.spacedEdgeImage = _parameters->spacedEdgeImage;
+		parameters.rankTransform   = _parameters->rankTransform;
+		parameters.quantiles       = _parameters->quantiles;
 	}
 
-	if (_parameters->sameIntensityComponents) {
+	// components of levels that are not present in the image are duplicates
+	// that our visitor discards anyway -- don't let the parser generate them
+	parameters.skipEmptyLevels = true;
 
-		ImageType separatedRegions = *_image;
-		for (unsigned int y = 0; y < separatedRegions.height() - 1; y++)
-			for (unsigned int x = 0; x < separatedRegions.width() - 1; x++) {
+	// Parsed trees of images are identified by the key of the image and the 
+	// parameters, to find them in the cache or to reuse the unfiltered tree 
+	// of the previous extraction. Blocks are not considered, since their 
+	// contents are not known without reading them.
+	bool cached         = (!streaming && _parameters.isSet() && !_parameters->cacheDirectory.empty());
+	bool lazySizeFilter = (!streaming && _parameters.isSet() && _parameters->lazySizeFilter);
 
-				typename ImageType::value_type value = separatedRegions(x, y),
-				                               right = separatedRegions(x+1, y),
-				                               down  = separatedRegions(x, y+1);
+	// maximally stable regions are found on the unfiltered tree, such that 
+	// they do not depend on the size limits
+	bool mser = (_parameters.isSet() && _parameters->mser);
 
-				if ((value != right && right != 0) || (value != down && down != 0))
-					separatedRegions(x, y) = 0;
-			}
+	ComponentTreeCache::key_type key = 0;
+	if (cached || lazySizeFilter)
+		key = getCacheKey();
 
-		ImageLevelParser<Precision, ImageType> parser(separatedRegions, parameters);
+	boost::shared_ptr<FlatComponentTree> tree;
 
-		// let the visitor run over the components
-		parser.parse(visitor);
+	if (lazySizeFilter && _unfilteredTree && key == _unfilteredTreeKey) {
 
-	} else {
+		LOG_DEBUG(componenttreeextractorlog)
+				<< "image did not change, reusing unfiltered tree" << std::endl;
 
-		ImageLevelParser<Precision, ImageType> parser(*_image, parameters);
+		tree = _unfilteredTree;
+	}
 
-		// let the visitor run over the components
-		parser.parse(visitor);
+	boost::shared_ptr<ComponentTreeCache> cache;
+
+	if (!tree && cached) {
+
+		cache = boost::make_shared<ComponentTreeCache>(_parameters->cacheDirectory, _parameters->cacheSize);
+		tree  = cache->get(key);
+	}
+
+	if (!tree) {
+
+		// create a new visitor, which filters by size only if the sizes are 
+		// not filtered after parsing
+		ComponentVisitor visitor(
+				imageSize,
+				(lazySizeFilter || mser ? 0 : minSize),
+				(lazySizeFilter || mser ? 0 : maxSize),
+				spacedEdgeImage);
+
+		if (streaming) {
+
+			if (_parameters.isSet() && _parameters->sameIntensityComponents)
+				LOG_ERROR(componenttreeextractorlog)
+						<< "same intensity components are not supported for blocks, "
+						<< "extracting the component tree of the intensities" << std::endl;
+
+			parseStrips(parameters, visitor);
+
+		} else if (sameIntensityComponents) {
+
+			parseSameIntensityComponents(parameters, visitor, std::integral_constant<bool, labelImage::value>());
+
+		} else {
+
+			// let the visitor run over the components
+			parse(*_image, parameters, visitor);
+		}
+
+		tree = visitor.getTree();
+
+		if (cache)
+			cache->put(key, *tree);
 	}
 
-	// set the root node in the component tree
-	_componentTree->setRoot(visitor.getRoot());
+	if (lazySizeFilter) {
+
+		_unfilteredTree    = tree;
+		_unfilteredTreeKey = key;
+
+	} else {
+
+		_unfilteredTree.reset();
+	}
+
+	const size_t wholeImageSize = (spacedEdgeImage ? imageSize/4 : imageSize);
+
+	if (mser && !tree->empty())
+		tree = getStableTree(
+				*tree,
+				_parameters->mserDelta,
+				_parameters->mserMaxVariation,
+				minSize,
+				maxSize,
+				wholeImageSize);
+	else if (lazySizeFilter)
+		tree = filterSizes(*tree, minSize, maxSize, wholeImageSize);
+
+	// set the component tree, the nodes are created when needed
+	_componentTree->setFlatTree(tree);
 
 	LOG_DEBUG(componenttreeextractorlog)
 			<< "extracted " << _componentTree->size()
 			<< " components" << std::endl;
 }
 
+template <typename Precision, typename ImageType>
+ComponentTreeCache::key_type
+ComponentTreeExtractor<Precision, ImageType>::getCacheKey() {
+
+	ComponentTreeCache::Hasher hasher;
+
+	hasher.add(sizeof(Precision));
+	hasher.add(sizeof(typename ImageType::value_type));
+
+	hasher.add(static_cast<size_t>(_image->width()));
+	hasher.add(static_cast<size_t>(_image->height()));
+	hasher.add(_image->data(), _image->size()*sizeof(typename ImageType::value_type));
+
+	bool edges = (_horizontalEdges.isSet() && _verticalEdges.isSet());
+	hasher.add(edges);
+
+	if (edges) {
+
+		hasher.add(static_cast<size_t>(_horizontalEdges->size()));
+		hasher.add(_horizontalEdges->data(), _horizontalEdges->size()*sizeof(typename ImageType::value_type));
+		hasher.add(static_cast<size_t>(_verticalEdges->size()));
+		hasher.add(_verticalEdges->data(), _verticalEdges->size()*sizeof(typename ImageType::value_type));
+	}
+
+	// the number of threads, the reuse of parsers, and the strip height 
+	// don't change the tree, and MSER filtering is done after parsing
+	hasher.add(_parameters->darkToBright);
+	hasher.add(_parameters->minIntensity);
+	hasher.add(_parameters->maxIntensity);
+	hasher.add(_parameters->sameIntensityComponents);
+	hasher.add(_parameters->spacedEdgeImage);
+	hasher.add(_parameters->unionFind);
+	hasher.add(_parameters->rankTransform);
+	hasher.add(_parameters->quantiles);
+
+	// unfiltered trees don't depend on the size limits
+	bool unfiltered = (_parameters->lazySizeFilter || _parameters->mser);
+	hasher.add(unfiltered);
+
+	if (!unfiltered) {
+
+		hasher.add(_parameters->minSize);
+		hasher.add(_parameters->maxSize);
+	}
+
+	return hasher.getKey();
+}
+
+template <typename Precision, typename ImageType>
+boost::shared_ptr<FlatComponentTree>
+ComponentTreeExtractor<Precision, ImageType>::filterSizes(
+		const FlatComponentTree& tree,
+		unsigned int             minSize,
+		unsigned int             maxSize,
+		size_t                   wholeImageSize) {
+
+	std::vector<bool> keep(tree.size());
+	for (FlatComponentTree::node_type node = 0; node < tree.size(); node++)
+		keep[node] = isValidSize(tree.getSize(node), minSize, maxSize, wholeImageSize);
+
+	boost::shared_ptr<FlatComponentTree> filtered = tree.filter(keep);
+
+	LOG_DEBUG(componenttreeextractorlog)
+			<< "kept " << filtered->size() << " of " << tree.size()
+			<< " components with sizes in [" << minSize << ", " << maxSize << ")" << std::endl;
+
+	return filtered;
+}
+
+template <typename Precision, typename ImageType>
+void
+ComponentTreeExtractor<Precision, ImageType>::computeVariations(
+		const FlatComponentTree& tree,
+		double                   delta,
+		std::vector<double>&     variations) {
+
+	const FlatComponentTree::node_type root = tree.getRoot();
+
+	// the values of the nodes, as stored by the visitor
+	std::vector<double> values(tree.size());
+	for (FlatComponentTree::node_type node = 0; node <= root; node++) {
+
+		typename ImageType::value_type value;
+		memcpy(&value, tree.getValue(node).data(), sizeof(value));
+		values[node] = value;
+	}
+
+	variations.assign(tree.size(), std::numeric_limits<double>::infinity());
+
+	for (FlatComponentTree::node_type node = 0; node < root; node++) {
+
+		// the parent is used even if it is further away than delta
+		FlatComponentTree::node_type ancestor = tree.getParent(node);
+
+		if (ancestor == FlatComponentTree::NoParent)
+			continue;
+
+		for (FlatComponentTree::node_type next = tree.getParent(ancestor);
+		     next != FlatComponentTree::NoParent && std::abs(values[next] - values[node]) <= delta;
+		     next = tree.getParent(next))
+			ancestor = next;
+
+		const double size = tree.getSize(node);
+
+		variations[node] = (tree.getSize(ancestor) - size)/size;
+	}
+}
+
+template <typename Precision, typename ImageType>
+boost::shared_ptr<FlatComponentTree>
+ComponentTreeExtractor<Precision, ImageType>::getStableTree(
+		const FlatComponentTree& tree,
+		double                   delta,
+		double                   maxVariation,
+		unsigned int             minSize,
+		unsigned int             maxSize,
+		size_t                   wholeImageSize) {
+
+	const FlatComponentTree::node_type root = tree.getRoot();
+
+	std::vector<double> variations;
+	computeVariations(tree, delta, variations);
+
+	// a node is stable if its variation is small enough and smaller than the 
+	// ones of its parent and its children
+	std::vector<bool> stable(tree.size());
+	for (FlatComponentTree::node_type node = 0; node < root; node++)
+		stable[node] = (variations[node] <= maxVariation);
+
+	for (FlatComponentTree::node_type node = 0; node < root; node++) {
+
+		FlatComponentTree::node_type parent = tree.getParent(node);
+
+		if (parent == FlatComponentTree::NoParent)
+			continue;
+
+		if (variations[node] < variations[parent]) {
+
+			stable[parent] = false;
+
+		} else {
+
+			stable[node] = false;
+			if (variations[node] == variations[parent])
+				stable[parent] = false;
+		}
+	}
+
+	stable[root] = true;
+
+	// filter the sizes only now, such that the ancestors used for the 
+	// variations do not depend on the size limits
+	for (FlatComponentTree::node_type node = 0; node < root; node++)
+		if (stable[node])
+			stable[node] = isValidSize(tree.getSize(node), minSize, maxSize, wholeImageSize);
+
+	boost::shared_ptr<FlatComponentTree> stableTree = tree.filter(stable);
+
+	LOG_DEBUG(componenttreeextractorlog)
+			<< "kept " << stableTree->size() << " of " << tree.size()
+			<< " components as maximally stable with sizes in [" 
+			<< minSize << ", " << maxSize << ")" << std::endl;
+
+	return stableTree;
+}
+
+template <typename Precision, typename ImageType>
+void
+ComponentTreeExtractor<Precision, ImageType>::parse(
+		const ImageType& image,
+		const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+		ComponentVisitor& visitor) {
+
+	if (_horizontalEdges.isSet() && _verticalEdges.isSet()) {
+
+		if (_parameters.isSet() && _parameters->unionFind)
+			LOG_ERROR(componenttreeextractorlog)
+					<< "union-find parsing of separate edge images is not supported, "
+					<< "using ImageLevelParser" << std::endl;
+
+		if (_parameters.isSet() && _parameters->reuseParser) {
+
+			if (_parsers.get())
+				_parsers->reset(image, *_horizontalEdges, *_verticalEdges, parameters);
+			else
+				_parsers.reset(new ImageLevelParser<Precision, ImageType>(image, *_horizontalEdges, *_verticalEdges, parameters));
+
+			_parsers->parse(visitor);
+
+		} else {
+
+			ImageLevelParser<Precision, ImageType> parser(image, *_horizontalEdges, *_verticalEdges, parameters);
+			parser.parse(visitor);
+		}
+
+	} else if (_parameters.isSet() && _parameters->unionFind) {
+
+		typename UnionFindParser<Precision, ImageType>::Parameters unionFindParameters(parameters);
+		unionFindParameters.numThreads = _parameters->numThreads;
+
+		UnionFindParser<Precision, ImageType> parser(image, unionFindParameters);
+		parser.parse(visitor);
+
+	} else if (_parameters.isSet() && _parameters->reuseParser) {
+
+		if (_parsers.get())
+			_parsers->reset(image, parameters);
+		else
+			_parsers.reset(new ImageLevelParser<Precision, ImageType>(image, parameters));
+
+		_parsers->parse(visitor);
+
+	} else {
+
+		ImageLevelParser<Precision, ImageType> parser(image, parameters);
+		parser.parse(visitor);
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+ComponentTreeExtractor<Precision, ImageType>::parseSameIntensityComponents(
+		const typename ImageLevelParser<Precision, ImageType>::Parameters&,
+		ComponentVisitor& visitor,
+		std::true_type) {
+
+	if (_parameters->spacedEdgeImage || (_horizontalEdges.isSet() && _verticalEdges.isSet()))
+		LOG_ERROR(componenttreeextractorlog)
+				<< "same intensity components of label images are extracted "
+				<< "from the image only, ignoring the edges" << std::endl;
+
+	SameIntensityParser<ImageType> parser(*_image);
+	parser.parse(visitor);
+}
+
+template <typename Precision, typename ImageType>
+void
+ComponentTreeExtractor<Precision, ImageType>::parseSameIntensityComponents(
+		const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+		ComponentVisitor& visitor,
+		std::false_type) {
+
+	ImageType separatedRegions = *_image;
+	for (unsigned int y = 0; y < separatedRegions.height() - 1; y++)
+		for (unsigned int x = 0; x < separatedRegions.width() - 1; x++) {
+
+			typename ImageType::value_type value = separatedRegions(x, y),
+			                               right = separatedRegions(x+1, y),
+			                               down  = separatedRegions(x, y+1);
+
+			if ((value != right && right != 0) || (value != down && down != 0))
+				separatedRegions(x, y) = 0;
+		}
+
+	// let the visitor run over the components
+	parse(separatedRegions, parameters, visitor);
+}
+
+template <typename Precision, typename ImageType>
+void
+ComponentTreeExtractor<Precision, ImageType>::parseStrips(
+		const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters,
+		ComponentVisitor& visitor) {
+
+	const unsigned int height      = _block->height();
+	const unsigned int stripHeight = std::max(1u, (_parameters.isSet() ? _parameters->stripHeight : 256u));
+
+	boost::shared_ptr<ImageBlockReader<ImageType> > reader = _blockFactory->getReader(_block->min().z());
+
+	if (!reader)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"the block factory does not provide a reader for section " << _block->min().z());
+
+	typename StreamingLevelParser<Precision, ImageType>::Parameters streamingParameters(parameters);
+
+	// all strips have to be discretized with the same intensity range, which 
+	// needs an additional pass over the strips if it was not given
+	if (!std::is_same<Precision, typename ImageType::value_type>::value &&
+	    streamingParameters.minIntensity == 0 && streamingParameters.maxIntensity == 0) {
+
+		bool first = true;
+
+		for (unsigned int row = 0; row < height; row += stripHeight) {
+
+			pipeline::Value<ImageType> rows = readRows(reader, row, std::min(height, row + stripHeight));
+
+			typename ImageType::value_type min, max;
+			if (!ImageDiscretizer<Precision, ImageType>::findRange(*rows, min, max))
+				continue;
+
+			streamingParameters.minIntensity = (first ? min : std::min(streamingParameters.minIntensity, min));
+			streamingParameters.maxIntensity = (first ? max : std::max(streamingParameters.maxIntensity, max));
+			first = false;
+		}
+
+		LOG_DEBUG(componenttreeextractorlog)
+				<< "intensity range of block is [" << streamingParameters.minIntensity
+				<< ", " << streamingParameters.maxIntensity << "]" << std::endl;
+	}
+
+	StreamingLevelParser<Precision, ImageType> parser(_block->width(), height, streamingParameters);
+
+	for (unsigned int row = 0; row < height; row += stripHeight) {
+
+		pipeline::Value<ImageType> rows = readRows(reader, row, std::min(height, row + stripHeight));
+		parser.addRows(*rows);
+	}
+
+	parser.parse(visitor);
+}
+
+template <typename Precision, typename ImageType>
+pipeline::Value<ImageType>
+ComponentTreeExtractor<Precision, ImageType>::readRows(
+		boost::shared_ptr<ImageBlockReader<ImageType> > reader,
+		unsigned int begin,
+		unsigned int end) {
+
+	LOG_ALL(componenttreeextractorlog)
+			<< "reading rows " << begin << " to " << end << " of block " << *_block << std::endl;
+
+	const util::box<unsigned int,3>& block = *_block;
+
+	pipeline::Value<util::box<unsigned int,3> > rows(
+			util::box<unsigned int,3>(
+					block.min().x(), block.min().y() + begin, block.min().z(),
+					block.max().x(), block.min().y() + end,   block.min().z() + 1));
+	pipeline::Value<unsigned int> section(block.min().z());
+
+	reader->setInput("block", rows);
+	reader->setInput("section", section);
+
+	pipeline::Value<ImageType> image;
+	image = reader->getOutput("image");
+
+	return image;
+}
+
 #endif // IMAGEPROCESSING_COMPNENT_TREE_EXTRACTOR_H__
 
@@ -1,7 +1,9 @@
 #ifndef IMAGEPROCESSING_COMPONENT_TREE_EXTRACTOR_PARAMETERS_H__
 #define IMAGEPROCESSING_COMPONENT_TREE_EXTRACTOR_PARAMETERS_H__
 
+#include <cstddef>
 #include <limits>
+#include <string>
 #include <pipeline/Data.h>
 
 template <typename ImageValueType = float>
@@ -14,7 +16,20 @@ struct ComponentTreeExtractorParameters : public pipeline::Data {
 		minIntensity(0),
 		maxIntensity(0),
 		sameIntensityComponents(false),
-		spacedEdgeImage(false) {}
+		spacedEdgeImage(false),
+		unionFind(false),
+		numThreads(1),
+		reuseParser(false),
+		rankTransform(false),
+		quantiles(false),
+		stripHeight(256),
+		numSectionThreads(0),
+		memoryBudget(0),
+		mser(false),
+		mserDelta(0),
+		mserMaxVariation(0.25),
+		lazySizeFilter(false),
+		cacheSize(0) {}
 
 	// extract components, start with the darkest
 	bool         darkToBright;
@@ -36,12 +51,80 @@ struct ComponentTreeExtractorParameters : public pipeline::Data {
 	ImageValueType minIntensity;
 	ImageValueType maxIntensity;
 
-	// extract a flat tree that has only same-intensity regions
+	// extract a flat tree that has only same-intensity regions (for images 
+	// with integral values, e.g., labels, see SameIntensityParser)
 	bool sameIntensityComponents;
 
 	// indicate that the image to parse is a scaled edge image (see 
 	// ImageLevelParser::Parameters for details)
 	bool spacedEdgeImage;
+
+	// build the component tree with UnionFindParser instead of 
+	// ImageLevelParser (see UnionFindParser for details), which results in 
+	// the same tree up to the order of the children of each node
+	bool unionFind;
+
+	// the number of threads to use for the union-find parser, which splits 
+	// the image into as many tiles to build the pixel tree and the nodes; 
+	// collecting the pixels and the traversal stay serial, and the memory 
+	// does not shrink with more tiles
+	unsigned int numThreads;
+
+	// keep one ImageLevelParser per thread and reuse its buffers for 
+	// subsequent images of the same size
+	bool reuseParser;
+
+	// use the ranks of the distinct intensities as levels instead of 
+	// discretizing the intensity range (see ImageDiscretizer), such that 
+	// the thresholds of the components are exact
+	bool rankTransform;
+
+	// discretize the intensities such that each level receives about the 
+	// same number of pixels, instead of spreading the levels evenly over the 
+	// intensity range (limited to 16 bit precision)
+	bool quantiles;
+
+	// the number of rows to read and parse at once, if the component tree 
+	// is extracted from a block factory instead of an image (see 
+	// StreamingLevelParser)
+	unsigned int stripHeight;
+
+	// the number of sections of an image stack to extract in parallel (see 
+	// ImageStackComponentTreeExtractor), 0 for one per hardware thread
+	unsigned int numSectionThreads;
+
+	// the number of bytes that the sections extracted in parallel are 
+	// allowed to use together (estimated from their sizes), 0 for no limit
+	size_t memoryBudget;
+
+	// keep only maximally stable extremal regions (MSER) and the root in the 
+	// tree: the variation of a component is the relative growth of its size 
+	// up to its largest ancestor whose value differs by at most mserDelta 
+	// (but at least up to its parent), and components are kept if their 
+	// variation is at most mserMaxVariation and smaller than the ones of 
+	// their parent and children. The variations are computed on the tree 
+	// before filtering by size, and minSize and maxSize are applied to the 
+	// stable components afterwards. With the default mserDelta of 0, the 
+	// variation is the growth up to the parent only, which is sensitive to 
+	// noise -- set mserDelta to a few intensity steps of the image.
+	bool           mser;
+	ImageValueType mserDelta;
+	double         mserMaxVariation;
+
+	// parse without size limits and filter the sizes afterwards, keeping the 
+	// unfiltered tree, such that changing minSize or maxSize does not parse 
+	// the image again (the unfiltered tree is also what is stored in the 
+	// cache)
+	bool lazySizeFilter;
+
+	// if not empty, store extracted trees in this directory and reuse them 
+	// for images and parameters that have been seen before, instead of 
+	// parsing again (see ComponentTreeCache)
+	std::string cacheDirectory;
+
+	// the number of bytes the trees in the cache directory are allowed to 
+	// use, 0 for no limit (least recently used trees are removed first)
+	size_t cacheSize;
 };
 
 #endif // IMAGEPROCESSING_COMPONENT_TREE_EXTRACTOR_PARAMETERS_H__
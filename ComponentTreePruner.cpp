@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <util/foreach.h>
 #include <util/Logger.h>
 #include "ComponentTreePruner.h"
@@ -23,6 +24,14 @@ ComponentTreePruner::updateOutputs() {
 void
 ComponentTreePruner::prune() {
 
+	boost::shared_ptr<FlatComponentTree> flatTree = _componentTree->getFlatTree();
+
+	if (flatTree) {
+
+		_pruned->setFlatTree(prune(flatTree));
+		return;
+	}
+
 	// the new root will be a clone of the old root
 	_root = boost::make_shared<ComponentTree::Node>(_componentTree->getRoot()->getComponent());
 
@@ -37,6 +46,91 @@ ComponentTreePruner::prune() {
 	_pruned->setRoot(_root);
 }
 
+boost::shared_ptr<FlatComponentTree>
+ComponentTreePruner::prune(boost::shared_ptr<FlatComponentTree> tree) {
+
+	typedef FlatComponentTree::node_type node_type;
+
+	if (tree->empty())
+		return tree;
+
+	const node_type root      = tree->getRoot();
+	const int       maxHeight = *_maxHeight;
+
+	// the height and number of descendants of each node, found from the 
+	// leaves up (children precede their parents)
+	std::vector<int>       heights(tree->size(), 0);
+	std::vector<node_type> numDescendants(tree->size(), 0);
+
+	for (node_type node = 0; node < root; node++) {
+
+		node_type parent = tree->getParent(node);
+
+		heights[parent]         = std::max(heights[parent], heights[node] + 1);
+		numDescendants[parent] += numDescendants[node] + 1;
+	}
+
+	// the whole tree did not exceed the threshold
+	if (heights[root] <= maxHeight)
+		return tree;
+
+	boost::shared_ptr<FlatComponentTree> pruned = boost::make_shared<FlatComponentTree>(tree->getPixelList());
+	pruned->reserve(tree->size());
+
+	// The nodes that exceed the threshold are the root and some of its 
+	// descendants. The subtrees of their children that do not exceed the 
+	// threshold are kept and connected to the root. Each subtree is stored 
+	// in one range of nodes and copied at once, in the order in which the 
+	// nodes exceeding the threshold are finalized.
+	for (node_type node = 0; node <= root; node++) {
+
+		if (heights[node] <= maxHeight)
+			continue;
+
+		for (FlatComponentTree::child_iterator child = tree->beginChildren(node); child != tree->endChildren(node); child++) {
+
+			if (heights[*child] > maxHeight)
+				continue;
+
+			const node_type begin  = *child - numDescendants[*child];
+			const node_type offset = pruned->size() - begin;
+
+			for (node_type n = begin; n <= *child; n++) {
+
+				pruned->addNode(
+						tree->getValue(n),
+						tree->beginPixels(n),
+						tree->endPixels(n),
+						tree->getBoundingBox(n),
+						tree->getCenter(n));
+
+				if (n != *child)
+					pruned->setParent(n + offset, tree->getParent(n) + offset);
+			}
+		}
+	}
+
+	const node_type prunedRoot =
+			pruned->addNode(
+					tree->getValue(root),
+					tree->beginPixels(root),
+					tree->endPixels(root),
+					tree->getBoundingBox(root),
+					tree->getCenter(root));
+
+	for (node_type node = 0; node < prunedRoot; node++)
+		if (pruned->getParent(node) == FlatComponentTree::NoParent)
+			pruned->setParent(node, prunedRoot);
+
+	pruned->updateChildren();
+
+	LOG_DEBUG(componenttreeprunerlog)
+			<< "kept " << pruned->size() << " of " << tree->size()
+			<< " components" << std::endl;
+
+	return pruned;
+}
+
 boost::shared_ptr<ComponentTree::Node>
 ComponentTreePruner::prune(
 		boost::shared_ptr<ComponentTree::Node> node,
@@ -8,6 +8,9 @@
  * The component tree pruner removes nodes from a given component tree if they 
  * exceed a maximal height in the tree. The height is counted as the maximum 
  * number downwards of edges to a leaf node.
+ *
+ * Component trees that are given as flat trees are pruned on the flat tree in 
+ * linear passes over the nodes, without creating nodes.
  */
 class ComponentTreePruner : public pipeline::SimpleProcessNode<> {
 
@@ -21,6 +24,11 @@ private:
 
 	void prune();
 
+	/**
+	 * Prune a flat component tree.
+	 */
+	boost::shared_ptr<FlatComponentTree> prune(boost::shared_ptr<FlatComponentTree> tree);
+
 	/**
 	 * Prune the subtree rooted at node, return the result and the level of node 
 	 * counted from the bottom.
@@ -1,5 +1,12 @@
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <util/Logger.h>
+#include <util/exceptions.h>
+#include <imageprocessing/io/ComponentTreeFile.h>
 #include "ComponentTrees.h"
 
+logger::LogChannel componenttreeslog("componenttreeslog", "[ComponentTrees] ");
+
 ComponentTrees::ComponentTrees()
 {
 
@@ -8,6 +15,7 @@ ComponentTrees::ComponentTrees()
 boost::shared_ptr<ComponentTree>&
 ComponentTrees::getTree(unsigned int section)
 {
+	load(section);
 	return _treeSet[section];
 }
 
@@ -15,6 +23,7 @@ void
 ComponentTrees::setTree(unsigned int section,
 						 const boost::shared_ptr<ComponentTree>& tree)
 {
+	_files.erase(section);
 	_treeSet[section] = tree;
 }
 
@@ -22,11 +31,14 @@ void
 ComponentTrees::clear()
 {
 	_treeSet.clear();
+	_files.clear();
 }
 
 boost::shared_ptr<ComponentTree>
 ComponentTrees::operator[](unsigned int section)
 {
+	load(section);
+	
 	if (_treeSet.count(section))
 	{
 		return getTree(section);
@@ -41,5 +53,100 @@ ComponentTrees::operator[](unsigned int section)
 
 int ComponentTrees::size()
 {
-	return _treeSet.size();
+	return _treeSet.size() + _files.size();
+}
+
+void
+ComponentTrees::write(const std::string& directory)
+{
+	boost::filesystem::path dir(directory);
+	
+	if (!boost::filesystem::exists(dir))
+		boost::filesystem::create_directories(dir);
+	
+	loadAll();
+	
+	LOG_DEBUG(componenttreeslog) << "writing " << _treeSet.size() << " trees to " << directory << std::endl;
+	
+	for (trees_type::iterator i = _treeSet.begin(); i != _treeSet.end(); i++)
+	{
+		if (!i->second)
+			continue;
+		
+		boost::filesystem::path filename = dir / ("section_" + boost::lexical_cast<std::string>(i->first) + ".ctree");
+		
+		// Trees read from this directory are still mapped from their files. 
+		// Write to a temporary file and replace the old file afterwards, 
+		// which keeps the mapping of the old file valid.
+		boost::filesystem::path tmp = dir / boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+		
+		try
+		{
+			ComponentTreeFile::write(*i->second, tmp.string());
+			boost::filesystem::rename(tmp, filename);
+		}
+		catch (...)
+		{
+			boost::system::error_code error;
+			boost::filesystem::remove(tmp, error);
+			throw;
+		}
+	}
+}
+
+void
+ComponentTrees::read(const std::string& directory)
+{
+	boost::filesystem::path dir(directory);
+	
+	if (!boost::filesystem::is_directory(dir))
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				directory << " is not a directory");
+	
+	clear();
+	
+	for (boost::filesystem::directory_iterator i(dir); i != boost::filesystem::directory_iterator(); i++)
+	{
+		const std::string stem = i->path().stem().string();
+		
+		if (i->path().extension() != ".ctree" || stem.compare(0, 8, "section_") != 0)
+			continue;
+		
+		try
+		{
+			unsigned int section = boost::lexical_cast<unsigned int>(stem.substr(8));
+			_files[section] = i->path().string();
+		}
+		catch (boost::bad_lexical_cast&)
+		{
+			LOG_DEBUG(componenttreeslog) << "skipping " << i->path() << std::endl;
+		}
+	}
+	
+	LOG_DEBUG(componenttreeslog) << "found " << _files.size() << " trees in " << directory << std::endl;
+}
+
+void
+ComponentTrees::load(unsigned int section) const
+{
+	std::map<unsigned int, std::string>::iterator file = _files.find(section);
+	
+	if (file == _files.end())
+		return;
+	
+	LOG_ALL(componenttreeslog) << "loading tree of section " << section << " from " << file->second << std::endl;
+	
+	boost::shared_ptr<ComponentTree> tree = boost::make_shared<ComponentTree>();
+	tree->setFlatTree(ComponentTreeFile::read(file->second));
+	
+	_treeSet[section] = tree;
+	_files.erase(file);
+}
+
+void
+ComponentTrees::loadAll() const
+{
+	while (!_files.empty())
+		load(_files.begin()->first);
 }
@@ -3,9 +3,16 @@
 
 #include <boost/shared_ptr.hpp>
 #include <map>
+#include <string>
 #include <pipeline/Data.h>
 #include <imageprocessing/ComponentTree.h>
 
+/**
+ * The component trees of the sections of an image stack. The trees can be
+ * written to a directory with one file per section (see ComponentTreeFile),
+ * and read back from there. Trees that are read are only loaded when they are
+ * accessed for the first time.
+ */
 class ComponentTrees : public pipeline::Data
 {
 	typedef std::map<unsigned int, boost::shared_ptr<ComponentTree> > trees_type;
@@ -32,16 +39,44 @@ public:
 	 */
 	boost::shared_ptr<ComponentTree> operator[] (unsigned int section);
 	
-	const const_iterator begin() const {return _treeSet.begin(); }
-	const const_iterator end() const { return _treeSet.end(); }
+	/**
+	 * Iteration loads all trees that have not been loaded, yet.
+	 */
+	const const_iterator begin() const { loadAll(); return _treeSet.begin(); }
+	const const_iterator end() const { loadAll(); return _treeSet.end(); }
 	
-	const iterator begin() { return _treeSet.begin(); }
-	const iterator end() { return _treeSet.end(); }
+	const iterator begin() { loadAll(); return _treeSet.begin(); }
+	const iterator end() { loadAll(); return _treeSet.end(); }
 	
 	int size();
 	
+	/**
+	 * Write the trees to the given directory, one file 
+	 * section_<section>.ctree per section. Existing files are replaced, 
+	 * which is safe even if the trees were read from the same directory.
+	 */
+	void write(const std::string& directory);
+	
+	/**
+	 * Replace the trees by the trees in the given directory, as written by
+	 * write(). The files are only read when the tree of their section is 
+	 * accessed.
+	 */
+	void read(const std::string& directory);
+	
 private:
-	trees_type _treeSet;
+	/**
+	 * Load the tree of the given section, if it was not loaded, yet.
+	 */
+	void load(unsigned int section) const;
+	
+	void loadAll() const;
+	
+	// trees are loaded on demand, even through const accessors
+	mutable trees_type _treeSet;
+	
+	// the files of trees that have not been loaded, yet
+	mutable std::map<unsigned int, std::string> _files;
 	
 };
 
@@ -10,6 +10,113 @@
 #include <util/geometry.hpp>
 #include "ConnectedComponent.h"
 
+/**
+ * Compute the bounding box of pixels that are given as linear indices into an
+ * image of the given width. The y extent follows directly from the smallest
+ * and largest index, only the x extent needs the indices to be decoded.
+ */
+static void
+compactBoundingBox(
+		const unsigned int* indices,
+		const unsigned int* indicesEnd,
+		unsigned int        width,
+		util::box<int,2>&   boundingBox) {
+
+	unsigned int minIndex = *indices;
+	unsigned int maxIndex = *indices;
+	unsigned int minX     = *indices % width;
+	unsigned int maxX     = minX;
+
+#ifdef __SSE4_1__
+
+	// The vectorized loop decodes y as floor((i + 0.5)/width) in double 
+	// precision. This is exact as long as the rounding error of the product 
+	// stays below 0.5/width, which holds for widths smaller than 2^18. A width 
+	// of at least 2 keeps y in the range of signed integers.
+	if (width >= 2 && width < (1 << 18)) {
+
+		// Iterate until 16-byte alignment is reached.
+		while (((std::uintptr_t) indices % 16) != 0 && indices < indicesEnd) {
+
+			unsigned int x = *indices % width;
+
+			minIndex = std::min(minIndex, *indices);
+			maxIndex = std::max(maxIndex, *indices);
+			minX     = std::min(minX, x);
+			maxX     = std::max(maxX, x);
+
+			indices++;
+		}
+
+		__m128i minIndices = _mm_set1_epi32(minIndex);
+		__m128i maxIndices = _mm_set1_epi32(maxIndex);
+		__m128i minXs      = _mm_set1_epi32(minX);
+		__m128i maxXs      = _mm_set1_epi32(maxX);
+
+		// indices are unsigned, convert them to signed by subtracting 2^31 
+		// (flipping the sign bit) and add 2^31 back after the conversion to 
+		// double
+		const __m128i signBit  = _mm_set1_epi32(0x80000000);
+		const __m128d bias     = _mm_set1_pd(2147483648.0 + 0.5);
+		const __m128d invWidth = _mm_set1_pd(1.0/width);
+		const __m128i widths   = _mm_set1_epi32(width);
+
+		// Vectorized loop. Strides one packed integer vector of four indices.
+		while (indices + 4 <= indicesEnd) {
+
+			__m128i index = _mm_load_si128((__m128i*)indices);
+			indices += 4;
+
+			__m128i signedIndex = _mm_xor_si128(index, signBit);
+			__m128d lo = _mm_cvtepi32_pd(signedIndex);
+			__m128d hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(signedIndex, _MM_SHUFFLE(1, 0, 3, 2)));
+			lo = _mm_mul_pd(_mm_add_pd(lo, bias), invWidth);
+			hi = _mm_mul_pd(_mm_add_pd(hi, bias), invWidth);
+
+			__m128i y = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+			__m128i x = _mm_sub_epi32(index, _mm_mullo_epi32(y, widths));
+
+			minIndices = _mm_min_epu32(minIndices, index);
+			maxIndices = _mm_max_epu32(maxIndices, index);
+			minXs      = _mm_min_epu32(minXs, x);
+			maxXs      = _mm_max_epu32(maxXs, x);
+		}
+
+		// Readout packed vectors.
+		__attribute__((aligned(16))) unsigned int lanes[4][4];
+		_mm_store_si128((__m128i*)lanes[0], minIndices);
+		_mm_store_si128((__m128i*)lanes[1], maxIndices);
+		_mm_store_si128((__m128i*)lanes[2], minXs);
+		_mm_store_si128((__m128i*)lanes[3], maxXs);
+
+		for (int i = 0; i < 4; i++) {
+
+			minIndex = std::min(minIndex, lanes[0][i]);
+			maxIndex = std::max(maxIndex, lanes[1][i]);
+			minX     = std::min(minX,     lanes[2][i]);
+			maxX     = std::max(maxX,     lanes[3][i]);
+		}
+	}
+
+#endif // __SSE4_1__
+
+	// Iterate through any remaining pixels.
+	for (; indices < indicesEnd; indices++) {
+
+		unsigned int x = *indices % width;
+
+		minIndex = std::min(minIndex, *indices);
+		maxIndex = std::max(maxIndex, *indices);
+		minX     = std::min(minX, x);
+		maxX     = std::max(maxX, x);
+	}
+
+	boundingBox.min().x() = (int)minX;
+	boundingBox.min().y() = (int)(minIndex/width);
+	boundingBox.max().x() = (int)maxX + 1;
+	boundingBox.max().y() = (int)(maxIndex/width) + 1;
+}
+
 ConnectedComponent::ConnectedComponent(
 		std::array<char, 8> value,
 		boost::shared_ptr<pixel_list_type> pixelList,
@@ -24,13 +131,20 @@ ConnectedComponent::ConnectedComponent(
 	_pixelRange(begin, end),
 	_bitmapDirty(true) {
 
+	// compact pixel lists have their own bounding box kernel
+	if (begin != end && begin.width() != 0) {
+
+		compactBoundingBox(begin.data(), end.data(), begin.width(), _boundingBox);
+		return;
+	}
+
 #ifdef __SSE4_1__
 
 	// if there is at least one pixel
 	if (begin != end) {
 
-		unsigned int*__restrict__ pixels    = (unsigned int*)&*begin;
-		unsigned int*__restrict__ pixelsEnd = (unsigned int*)&*end;
+		const unsigned int*__restrict__ pixels    = begin.data();
+		const unsigned int*__restrict__ pixelsEnd = end.data();
 
 		// Prepare aligned, packed integer values.
 		typedef union {
@@ -133,6 +247,22 @@ ConnectedComponent::ConnectedComponent(
 #endif // __SSE4_1__
 }
 
+ConnectedComponent::ConnectedComponent(
+		std::array<char, 8> value,
+		boost::shared_ptr<pixel_list_type> pixelList,
+		pixel_list_type::const_iterator begin,
+		pixel_list_type::const_iterator end,
+		const util::box<int,2>& boundingBox,
+		const util::point<double,2>& center) :
+
+	_pixels(pixelList),
+	_value(value),
+	_boundingBox(boundingBox),
+	_center(center),
+	_centerDirty(false),
+	_pixelRange(begin, end),
+	_bitmapDirty(true) {}
+
 ConnectedComponent::ConnectedComponent(
 		std::array<char, 8> value,
 		const util::point<int,2>& offset,
@@ -46,6 +46,18 @@ public:
 			pixel_list_type::const_iterator begin,
 			pixel_list_type::const_iterator end);
 
+	/**
+	 * Create a component with a bounding box and center that are already
+	 * known, e.g., from attributes accumulated while parsing an image.
+	 */
+	ConnectedComponent(
+			std::array<char, 8> value,
+			boost::shared_ptr<pixel_list_type> pixelList,
+			pixel_list_type::const_iterator begin,
+			pixel_list_type::const_iterator end,
+			const util::box<int,2>& boundingBox,
+			const util::point<double,2>& center);
+
 	ConnectedComponent(
 			std::array<char, 8>  value,
 			const util::point<int,2>& offset,
@@ -0,0 +1,173 @@
+#include <cassert>
+#include <boost/make_shared.hpp>
+#include "FlatComponentTree.h"
+
+const FlatComponentTree::node_type FlatComponentTree::NoParent = std::numeric_limits<FlatComponentTree::node_type>::max();
+
+FlatComponentTree::FlatComponentTree(boost::shared_ptr<PixelList> pixelList) :
+	_pixelList(pixelList),
+	_childrenDirty(false) {
+
+	// the children of the empty tree
+	_childrenBegins.push_back(0);
+}
+
+void
+FlatComponentTree::clear(boost::shared_ptr<PixelList> pixelList) {
+
+	_pixelList = pixelList;
+
+	_parents.clear();
+	_children.clear();
+	_childrenBegins.clear();
+	_childrenBegins.push_back(0);
+	_childrenDirty = false;
+
+	_values.clear();
+	_pixelBegins.clear();
+	_pixelEnds.clear();
+	_boundingBoxes.clear();
+	_centers.clear();
+
+	_storage.reset();
+}
+
+void
+FlatComponentTree::reserve(size_t numNodes) {
+
+	_parents.reserve(numNodes);
+	_values.reserve(numNodes);
+	_pixelBegins.reserve(numNodes);
+	_pixelEnds.reserve(numNodes);
+	_boundingBoxes.reserve(numNodes);
+	_centers.reserve(numNodes);
+}
+
+FlatComponentTree::node_type
+FlatComponentTree::addNode(
+		const std::array<char, 8>&   value,
+		PixelList::const_iterator    begin,
+		PixelList::const_iterator    end,
+		const util::box<int,2>&      boundingBox,
+		const util::point<double,2>& center) {
+
+	node_type node = _parents.size();
+
+	_parents.push_back(NoParent);
+	_values.push_back(value);
+	_pixelBegins.push_back(begin - _pixelList->begin());
+	_pixelEnds.push_back(end - _pixelList->begin());
+	_boundingBoxes.push_back(boundingBox);
+	_centers.push_back(center);
+
+	_childrenDirty = true;
+
+	return node;
+}
+
+void
+FlatComponentTree::setParent(node_type node, node_type parent) {
+
+	_parents.set(node, parent);
+	_childrenDirty = true;
+}
+
+FlatComponentTree::child_iterator
+FlatComponentTree::beginChildren(node_type node) const {
+
+	assert(!_childrenDirty);
+
+	return _children.data() + _childrenBegins[node];
+}
+
+FlatComponentTree::child_iterator
+FlatComponentTree::endChildren(node_type node) const {
+
+	assert(!_childrenDirty);
+
+	return _children.data() + _childrenBegins[node + 1];
+}
+
+size_t
+FlatComponentTree::getNumChildren(node_type node) const {
+
+	assert(!_childrenDirty);
+
+	return _childrenBegins[node + 1] - _childrenBegins[node];
+}
+
+void
+FlatComponentTree::updateChildren() {
+
+	if (!_childrenDirty)
+		return;
+
+	const size_t numNodes = _parents.size();
+
+	// count the children of each node
+	std::vector<node_type> childrenBegins(numNodes + 1, 0);
+	for (node_type node = 0; node < numNodes; node++)
+		if (_parents[node] != NoParent)
+			childrenBegins[_parents[node] + 1]++;
+
+	for (node_type node = 0; node < numNodes; node++)
+		childrenBegins[node + 1] += childrenBegins[node];
+
+	// place the children in increasing order
+	std::vector<node_type> children(childrenBegins[numNodes]);
+	std::vector<node_type> next(childrenBegins.begin(), childrenBegins.end() - 1);
+	for (node_type node = 0; node < numNodes; node++)
+		if (_parents[node] != NoParent)
+			children[next[_parents[node]]++] = node;
+
+	_children.assign(children);
+	_childrenBegins.assign(childrenBegins);
+	_childrenDirty = false;
+}
+
+boost::shared_ptr<FlatComponentTree>
+FlatComponentTree::filter(const std::vector<bool>& keep) const {
+
+	const size_t numNodes = _parents.size();
+
+	boost::shared_ptr<FlatComponentTree> filtered = boost::make_shared<FlatComponentTree>(_pixelList);
+	filtered->reserve(numNodes);
+
+	// the index of each node in the filtered tree, or of its closest kept 
+	// ancestor, found from the root down (parents follow their children)
+	std::vector<node_type> filteredNodes(numNodes, NoParent);
+	std::vector<node_type> filteredAncestors(numNodes, NoParent);
+
+	for (node_type node = numNodes; node-- > 0;) {
+
+		node_type parent = _parents[node];
+
+		if (parent != NoParent)
+			filteredAncestors[node] = (keep[parent] ? parent : filteredAncestors[parent]);
+	}
+
+	// copy the kept nodes in post-order
+	for (node_type node = 0; node < numNodes; node++) {
+
+		if (!keep[node])
+			continue;
+
+		filteredNodes[node] = filtered->_parents.size();
+
+		filtered->_parents.push_back(NoParent);
+		filtered->_values.push_back(_values[node]);
+		filtered->_pixelBegins.push_back(_pixelBegins[node]);
+		filtered->_pixelEnds.push_back(_pixelEnds[node]);
+		filtered->_boundingBoxes.push_back(_boundingBoxes[node]);
+		filtered->_centers.push_back(_centers[node]);
+	}
+
+	for (node_type node = 0; node < numNodes; node++)
+		if (keep[node] && filteredAncestors[node] != NoParent)
+			filtered->_parents.set(filteredNodes[node], filteredNodes[filteredAncestors[node]]);
+
+	filtered->_childrenDirty = true;
+	filtered->updateChildren();
+
+	return filtered;
+}
@@ -0,0 +1,304 @@
+#ifndef IMAGEPROCESSING_FLAT_COMPONENT_TREE_H__
+#define IMAGEPROCESSING_FLAT_COMPONENT_TREE_H__
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+
+#include <imageprocessing/PixelList.h>
+#include <imageprocessing/exceptions.h>
+#include <util/point.hpp>
+#include <util/box.hpp>
+
+class ComponentTreeFile;
+
+/**
+ * A component tree that stores its nodes in columns instead of individually
+ * allocated node objects. Nodes are identified by their index and stored in
+ * post-order, i.e., in the order in which the parsers finalize the
+ * components: Each node follows all of its descendants, and the root is the
+ * last node.
+ *
+ * The structure of the tree is given by the parent of each node and the
+ * children of each node, which are stored in one array with an offset per
+ * node (compressed sparse rows). The children are derived from the parents
+ * by updateChildren(), once the tree is complete. Afterwards, all accessors
+ * only read, such that the tree can be shared between threads. Each node has a value, a range in the shared
+ * pixel list, a bounding box, and a center.
+ *
+ * The columns can also refer to memory that is not owned by the tree, e.g., a
+ * memory mapped file (see ComponentTreeFile). Such trees can not be modified,
+ * adding nodes or setting parents throws an InvalidOperation.
+ */
+class FlatComponentTree {
+
+	/**
+	 * A column of the tree, either stored in a vector or referring to
+	 * external memory.
+	 */
+	template <typename T>
+	class Column {
+
+	public:
+
+		Column() : _data(0), _size(0), _mapped(false) {}
+
+		Column(const Column& other) :
+			_values(other._values),
+			_data(other._mapped ? other._data : _values.data()),
+			_size(other._size),
+			_mapped(other._mapped) {}
+
+		Column& operator=(const Column& other) {
+
+			_values = other._values;
+			_data   = (other._mapped ? other._data : _values.data());
+			_size   = other._size;
+			_mapped = other._mapped;
+
+			return *this;
+		}
+
+		const T& operator[](size_t i) const { return _data[i]; }
+
+		const T* data() const { return _data; }
+
+		size_t size() const { return _size; }
+
+		bool empty() const { return _size == 0; }
+
+		void push_back(const T& value) {
+
+			checkOwned();
+			_values.push_back(value);
+			update();
+		}
+
+		void set(size_t i, const T& value) {
+
+			checkOwned();
+			_values[i] = value;
+		}
+
+		void reserve(size_t size) {
+
+			checkOwned();
+			_values.reserve(size);
+			update();
+		}
+
+		void clear() { _values.clear(); update(); }
+
+		/**
+		 * Move the given values into this column, which leaves the given
+		 * vector empty.
+		 */
+		void assign(std::vector<T>& values) {
+
+			_values.clear();
+			_values.swap(values);
+			update();
+		}
+
+		/**
+		 * Let this column refer to external memory.
+		 */
+		void map(const T* data, size_t size) {
+
+			std::vector<T>().swap(_values);
+			_data   = data;
+			_size   = size;
+			_mapped = true;
+		}
+
+	private:
+
+		/**
+		 * Columns that refer to external memory are read-only.
+		 */
+		void checkOwned() const {
+
+			if (_mapped)
+				UTIL_THROW_EXCEPTION(
+						InvalidOperation,
+						"component trees in external memory can not be modified");
+		}
+
+		void update() {
+
+			_data   = _values.data();
+			_size   = _values.size();
+			_mapped = false;
+		}
+
+		std::vector<T> _values;
+		const T*       _data;
+		size_t         _size;
+		bool           _mapped;
+	};
+
+public:
+
+	typedef unsigned int node_type;
+
+	/**
+	 * The parent of nodes that don't have a parent (yet).
+	 */
+	static const node_type NoParent;
+
+	/**
+	 * Iterator over the children of a node.
+	 */
+	typedef const node_type* child_iterator;
+
+	/**
+	 * Create an empty tree for components with pixels in the given pixel list.
+	 */
+	FlatComponentTree(boost::shared_ptr<PixelList> pixelList = boost::shared_ptr<PixelList>());
+
+	/**
+	 * Remove all nodes and set a new pixel list.
+	 */
+	void clear(boost::shared_ptr<PixelList> pixelList);
+
+	/**
+	 * Reserve memory for the given number of nodes.
+	 */
+	void reserve(size_t numNodes);
+
+	/**
+	 * Append a node without a parent. Nodes have to be added in post-order,
+	 * i.e., after all of their descendants.
+	 *
+	 * @param value
+	 *              The value of the component.
+	 * @param begin, end
+	 *              The range of the pixels of the component in the pixel list.
+	 * @param boundingBox
+	 *              The bounding box of the component.
+	 * @param center
+	 *              The center of the component.
+	 *
+	 * @return The index of the new node.
+	 */
+	node_type addNode(
+			const std::array<char, 8>&   value,
+			PixelList::const_iterator    begin,
+			PixelList::const_iterator    end,
+			const util::box<int,2>&      boundingBox,
+			const util::point<double,2>& center);
+
+	/**
+	 * Set the parent of a node. The parent has to follow the node.
+	 */
+	void setParent(node_type node, node_type parent);
+
+	/**
+	 * Collect the children of each node from the parents. Has to be called 
+	 * after nodes were added or parents were set, before the children are 
+	 * accessed. Trees created by filter() or read by ComponentTreeFile have 
+	 * their children already.
+	 */
+	void updateChildren();
+
+	/**
+	 * The number of nodes in this tree.
+	 */
+	size_t size() const { return _parents.size(); }
+
+	/**
+	 * True, if this tree does not have any nodes.
+	 */
+	bool empty() const { return _parents.empty(); }
+
+	/**
+	 * The root of the tree, which is the last node.
+	 */
+	node_type getRoot() const { return _parents.size() - 1; }
+
+	/**
+	 * The parent of the given node, or NoParent for the root.
+	 */
+	node_type getParent(node_type node) const { return _parents[node]; }
+
+	/**
+	 * The children of the given node, in the order they were added. Only 
+	 * valid after updateChildren().
+	 */
+	child_iterator beginChildren(node_type node) const;
+	child_iterator endChildren(node_type node) const;
+
+	/**
+	 * The number of children of the given node.
+	 */
+	size_t getNumChildren(node_type node) const;
+
+	/**
+	 * The value of the component of the given node.
+	 */
+	const std::array<char, 8>& getValue(node_type node) const { return _values[node]; }
+
+	/**
+	 * The pixels of the component of the given node.
+	 */
+	PixelList::const_iterator beginPixels(node_type node) const { return _pixelList->begin() + _pixelBegins[node]; }
+	PixelList::const_iterator endPixels(node_type node) const { return _pixelList->begin() + _pixelEnds[node]; }
+
+	/**
+	 * The number of pixels of the component of the given node.
+	 */
+	unsigned int getSize(node_type node) const { return _pixelEnds[node] - _pixelBegins[node]; }
+
+	/**
+	 * The bounding box of the component of the given node.
+	 */
+	const util::box<int,2>& getBoundingBox(node_type node) const { return _boundingBoxes[node]; }
+
+	/**
+	 * The center of the component of the given node.
+	 */
+	const util::point<double,2>& getCenter(node_type node) const { return _centers[node]; }
+
+	/**
+	 * The pixel list shared by all components of this tree.
+	 */
+	boost::shared_ptr<PixelList> getPixelList() const { return _pixelList; }
+
+	/**
+	 * Create a tree of the nodes for which 'keep' is true, in one pass over 
+	 * the nodes. The parent of each kept node is its closest kept ancestor. 
+	 * The new tree shares the pixel list with this tree.
+	 */
+	boost::shared_ptr<FlatComponentTree> filter(const std::vector<bool>& keep) const;
+
+private:
+
+	// reads and writes the columns directly
+	friend class ComponentTreeFile;
+
+	boost::shared_ptr<PixelList> _pixelList;
+
+	// the structure of the tree
+	Column<node_type> _parents;
+
+	// the children of all nodes, and the begin of the children of each node
+	// in there (plus the total number of children), and whether nodes or 
+	// parents changed since they were collected
+	Column<node_type> _children;
+	Column<node_type> _childrenBegins;
+	bool              _childrenDirty;
+
+	// the attributes of the nodes
+	Column<std::array<char, 8> >   _values;
+	Column<unsigned int>           _pixelBegins;
+	Column<unsigned int>           _pixelEnds;
+	Column<util::box<int,2> >      _boundingBoxes;
+	Column<util::point<double,2> > _centers;
+
+	// external memory the columns refer to, if any
+	boost::shared_ptr<const void> _storage;
+};
+
+#endif // IMAGEPROCESSING_FLAT_COMPONENT_TREE_H__
+
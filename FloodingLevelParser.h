@@ -0,0 +1,970 @@
+#ifndef IMAGEPROCESSING_FLOODING_LEVEL_PARSER_H__
+#define IMAGEPROCESSING_FLOODING_LEVEL_PARSER_H__
+
+#include <stack>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <boost/container/flat_map.hpp>
+
+#include <util/Logger.h>
+#include "ImageDiscretizer.h"
+#include "ComponentAttributes.h"
+#include "VisitorCallbacks.h"
+
+namespace image_level_parser_detail {
+
+	template <typename Precision>
+	class BoundaryLocations {
+
+	public:
+
+		// locations are linear offsets into the (padded) image
+		typedef unsigned int location_type;
+
+		/**
+		 * Put a boundary location with its level on the stack of open boundary
+		 * locations.
+		 */
+		virtual void push(
+				const location_type& location,
+				const Precision      level) = 0;
+
+		/**
+		 * Get the next open boundary location with the given level. Returns
+		 * false if there is none.
+		 *
+		 * @param level
+		 *              The reference level.
+		 *
+		 * @param boundaryLocation
+		 *              [out] The next boundary location with level smaller then
+		 *              level.
+		 */
+		virtual bool pop(
+				const Precision level,
+				location_type&  boundaryLocation) = 0;
+
+		/**
+		 * Get the lowest open boundary location that has a level smaller than
+		 * the given level.
+		 *
+		 * @param level
+		 *              The reference level.
+		 *
+		 * @param boundaryLocation
+		 *              [out] The lowest boundary location with level smaller
+		 *              then level.
+		 *
+		 * @param boundaryLevel
+		 *              [out] The level of the found boundary location.
+		 *
+		 * @return true, if there is such a boundary location
+		 */
+		virtual bool popLowest(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel) = 0;
+
+		/**
+		 * Get the next open boundary location that has a level higher than the
+		 * given level.
+		 *
+		 * @param level
+		 *              The reference level.
+		 *
+		 * @param boundaryLocation
+		 *              [out] The next boundary location with level higher then
+		 *              level.
+		 *
+		 * @param boundaryLevel
+		 *              [out] The level of the found boundary location.
+		 *
+		 * @return true, if there is such a boundary location
+		 */
+		virtual bool popHigher(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel) = 0;
+
+		/**
+		 * Remove all boundary locations.
+		 */
+		virtual void clear() = 0;
+	};
+
+	/**
+	 * Boundary locations stored in one contiguous vector per level. Non-empty 
+	 * levels are marked in a two-level occupancy bitmap (one bit per level, 
+	 * and one bit per 64-bit word of level bits), such that the next non-empty 
+	 * level can be found with a few find-first-set operations instead of a 
+	 * scan over all levels.
+	 */
+	template <typename Precision>
+	class DenseBoundaryLocations : BoundaryLocations<Precision> {
+
+	public:
+
+		typedef typename BoundaryLocations<Precision>::location_type location_type;
+
+		DenseBoundaryLocations(Precision maxValue) :
+			_boundaryLocations(static_cast<size_t>(maxValue) + 1),
+			_levelBits(static_cast<size_t>(maxValue)/64 + 1, 0),
+			_wordBits(static_cast<size_t>(maxValue)/(64*64) + 1, 0),
+			MAX_LEVEL(maxValue) {}
+
+		void push(
+				const location_type& location,
+				const Precision      level);
+
+		bool pop(
+				const Precision level,
+				location_type&  boundaryLocation);
+
+		bool popLowest(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel);
+
+		bool popHigher(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel);
+
+		void clear();
+
+	private:
+		typedef std::vector<std::vector<location_type> > boundary_locations_type;
+
+		/**
+		 * Find the smallest non-empty level that is not smaller than the given 
+		 * level. Returns false, if there is none.
+		 */
+		bool findNonEmpty(size_t from, size_t& level) const;
+
+		inline void setNonEmpty(size_t level) {
+
+			_levelBits[level/64]     |= (uint64_t)1 << (level%64);
+			_wordBits[level/(64*64)] |= (uint64_t)1 << ((level/64)%64);
+		}
+
+		inline void setEmpty(size_t level) {
+
+			_levelBits[level/64] &= ~((uint64_t)1 << (level%64));
+			if (_levelBits[level/64] == 0)
+				_wordBits[level/(64*64)] &= ~((uint64_t)1 << ((level/64)%64));
+		}
+
+		boundary_locations_type _boundaryLocations;
+
+		// one bit per level, set if the level has boundary locations
+		std::vector<uint64_t> _levelBits;
+
+		// one bit per word in _levelBits, set if the word is not zero
+		std::vector<uint64_t> _wordBits;
+
+		const Precision MAX_LEVEL;
+	};
+
+	template <typename Precision>
+	class SparseBoundaryLocations : BoundaryLocations<Precision> {
+
+	public:
+
+		typedef typename BoundaryLocations<Precision>::location_type location_type;
+
+		SparseBoundaryLocations(Precision maxValue) {
+			_boundaryLocations.reserve(std::min<size_t>({(size_t)maxValue + 1, 1024, 1<<(sizeof(Precision))}));
+		}
+
+		void push(
+				const location_type& location,
+				const Precision      level);
+
+		bool pop(
+				const Precision level,
+				location_type&  boundaryLocation);
+
+		bool popLowest(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel);
+
+		bool popHigher(
+				const Precision level,
+				location_type&  boundaryLocation,
+				Precision&      boundaryLevel);
+
+		void clear();
+
+	private:
+		typedef boost::container::flat_map<Precision, std::stack<location_type> > boundary_locations_type;
+
+		bool pop(
+			typename boundary_locations_type::value_type& val,
+			location_type& boundaryLocation);
+
+		boundary_locations_type _boundaryLocations;
+	};
+
+	template <typename Precision>
+	struct Traits {
+		typedef SparseBoundaryLocations<Precision> boundary_locations_type;
+	};
+
+	template <>
+	struct Traits<unsigned char> {
+		typedef DenseBoundaryLocations<unsigned char> boundary_locations_type;
+	};
+
+	template <>
+	struct Traits<unsigned short> {
+		typedef DenseBoundaryLocations<unsigned short> boundary_locations_type;
+	};
+}
+
+/**
+ * The flooding algorithm shared by ImageLevelParser and VolumeLevelParser: 
+ * Starting from one location, the levels of a padded image (or volume) are 
+ * filled from the lowest reachable level upwards, beginning a new component 
+ * whenever a lower level is entered and ending components whenever a higher 
+ * level is reached. Locations are linear offsets into the padded data, such 
+ * that the dimensionality only enters through the neighbor offsets.
+ *
+ * Derived classes (passed as the first template argument) set up the padded 
+ * levels, their states, and the neighbor offsets, and provide
+ *
+ *   typedef ... Visitor;
+ *   void addLocation(location_type location);
+ *   const ListType& reportedList() const;
+ *
+ * to add a newly visited location to their pixel list, and to get the list 
+ * that the iterators passed to the visitor refer to.
+ */
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+class FloodingLevelParser {
+
+protected:
+
+	// locations are linear offsets into the padded data
+	typedef typename image_level_parser_detail::BoundaryLocations<Precision>::location_type location_type;
+
+	typedef typename ImageDiscretizer<Precision, DataType>::value_type value_type;
+
+	typedef unsigned char Direction;
+
+	// states of the locations in the padded data
+	typedef unsigned char State;
+	enum { Unvisited = 0, Visited = 1, Border = 2 };
+
+	FloodingLevelParser(logger::LogChannel& log);
+
+	/**
+	 * Clear the stacks of the parsing algorithm, after the padded levels have 
+	 * been set up.
+	 */
+	void clearFlooding();
+
+	/**
+	 * Visit all components, starting at the given location.
+	 */
+	template <typename VisitorType>
+	void flood(location_type start, VisitorType& visitor);
+
+	static const Precision MaxValue;
+
+	// maps between original intensities and levels
+	ImageDiscretizer<Precision, DataType> _discretizer;
+
+	// the discretized data with a border, such that no bounds checks are 
+	// needed
+	std::vector<Precision> _paddedLevels;
+
+	// the state of each location in the padded data (border locations are 
+	// never valid)
+	std::vector<State> _state;
+
+	// offsets from a location to its neighbors in the padded data
+	int _neighborOffsets[NumNeighbors];
+
+	// sorted list of levels present in the data and the position of the 
+	// current level in it (only used if _skipEmptyLevels is set)
+	std::vector<Precision> _levels;
+	size_t                 _currentLevelIndex;
+	bool                   _skipEmptyLevels;
+
+	// the attributes of the open components, parallel to _componentBegins 
+	// (only used if the visitor accepts attributes)
+	std::vector<ComponentAttributes> _attributes;
+	bool                             _accumulateAttributes;
+
+private:
+
+	typedef typename ListType::const_iterator list_iterator;
+
+	Derived& derived() { return static_cast<Derived&>(*this); }
+
+	/**
+	 * Set the current location and level.
+	 */
+	template <typename VisitorType>
+	void gotoLocation(location_type location, VisitorType& visitor);
+
+	/**
+	 * Fill the level at the current location, including all lower levels 
+	 * that are reachable from it without crossing a higher level.
+	 */
+	template <typename VisitorType>
+	void fillLevel(VisitorType& visitor);
+
+	/**
+	 * In the current boundary locations, try to find the lowest level that is 
+	 * higher than the current level and go there. If such a level exists, all 
+	 * the open components until this level are closed (and the visitor 
+	 * informed) and true is returned. Otherwise, all remaining open components 
+	 * are closed (including the one for MaxValue) and false is returned.
+	 */
+	template <typename VisitorType>
+	bool gotoHigherLevel(VisitorType& visitor);
+
+	/**
+	 * In the current boundary locations, try to find the lowest level that is 
+	 * lower than the reference level and go there. If such a level exists, true 
+	 * is returned.
+	 */
+	template <typename VisitorType>
+	bool gotoLowerLevel(Precision referenceLevel, VisitorType& visitor);
+
+	/**
+	 * Begin a new connected component at the current location for the given 
+	 * level.
+	 */
+	template <typename VisitorType>
+	void beginComponent(Precision level, VisitorType& visitor);
+
+	/**
+	 * End the connected component of the given level at the current location.
+	 */
+	template <typename VisitorType>
+	void endComponent(Precision level, VisitorType& visitor);
+
+	/**
+	 * Find the neighbor of the current position in the given direction. Returns 
+	 * false, if the neighbor is not valid (out of bounds or already visited).  
+	 * Otherwise, neighborLocation and neighborLevel are set and true is 
+	 * returned.
+	 */
+	inline bool findNeighbor(Direction direction, location_type& neighborLocation, Precision& neighborLevel) {
+
+		neighborLocation = _currentLocation + _neighborOffsets[direction];
+
+		// out of bounds (the border) or already visited?
+		if (_state[neighborLocation] != Unvisited)
+			return false;
+
+		neighborLevel = _paddedLevels[neighborLocation];
+
+		return true;
+	}
+
+	// the current location of the parsing algorithm
+	location_type _currentLocation;
+	Precision     _currentLevel;
+	bool          _initCurrentLevel; // Indicates initializing the current level, since we cannot express MaxValue + 1
+
+	// stacks of open boundary locations
+	typename image_level_parser_detail::Traits<Precision>::boundary_locations_type _boundaryLocations;
+
+	// stack of component begin iterators into the reported list (with the 
+	// level they have been generated for)
+	std::vector<std::pair<Precision, list_iterator> > _componentBegins;
+
+	// the state of fillLevel for one level that is being filled
+	struct FillFrame {
+
+		// the level to fill
+		Precision targetLevel;
+
+		// the location to return to after lower levels have been filled
+		location_type location;
+
+		// the next direction to look at from the current location
+		Direction nextDirection;
+	};
+
+	// stack of levels that are being filled, the lowest on top
+	std::vector<FillFrame> _fillStack;
+
+	logger::LogChannel& _log;
+};
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+const Precision FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::MaxValue = std::numeric_limits<Precision>::max();
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::FloodingLevelParser(logger::LogChannel& log) :
+	_currentLevelIndex(0),
+	_skipEmptyLevels(false),
+	_accumulateAttributes(false),
+	_initCurrentLevel(false),
+	_boundaryLocations(MaxValue),
+	_log(log) {}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::clearFlooding() {
+
+	_boundaryLocations.clear();
+	_componentBegins.clear();
+	_attributes.clear();
+
+	// every frame on the fill stack is for a lower level than the one below
+	_fillStack.clear();
+	_fillStack.reserve(std::min(static_cast<size_t>(MaxValue) + 1, _paddedLevels.size()));
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::flood(location_type start, VisitorType& visitor) {
+
+	_accumulateAttributes = VisitorCallbacks<VisitorType, typename Derived::Visitor, Precision, value_type, list_iterator>::AcceptsAttributes;
+
+	// Pretend we come from level MaxValue + 1...
+	_currentLevel = MaxValue;
+	_currentLevelIndex = _levels.size();
+	_initCurrentLevel = true;
+
+	// ...and go to our initial location. This way we make sure enough 
+	// components are put on the stack.
+	gotoLocation(start, visitor);
+
+	LOG_ALL(_log)
+			<< "starting at " << _currentLocation
+			<< " with level " << (int)_currentLevel
+			<< std::endl;
+
+	// loop through the data
+	while (true) {
+
+		// fill the current level
+		fillLevel(visitor);
+
+		// try go to the smallest higher level, according to our open 
+		// boundary list; if there are no higher levels, we are done
+		if (!gotoHigherLevel(visitor))
+			return;
+	}
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::gotoLocation(location_type newLocation, VisitorType& visitor) {
+
+	Precision newLevel = _paddedLevels[newLocation];
+
+	// if we descend
+	if (_currentLevel > newLevel || _initCurrentLevel) {
+
+		if (_skipEmptyLevels) {
+
+			_initCurrentLevel = false;
+
+			// begin a new component for each present level that we descend
+			do {
+
+				_currentLevelIndex--;
+				beginComponent(_levels[_currentLevelIndex], visitor);
+
+			} while (_levels[_currentLevelIndex] != newLevel);
+
+		} else {
+
+			// begin a new component for each level that we descend
+			for (Precision level = _currentLevel - (_initCurrentLevel ? 0 : 1);; level--) {
+
+				_initCurrentLevel = false;
+
+				beginComponent(level, visitor);
+
+				if (level == newLevel)
+					break;
+			}
+		}
+
+	// if we ascend
+	} else if (_currentLevel < newLevel) {
+
+		if (_skipEmptyLevels) {
+
+			// close one component for each present level that we ascend
+			while (_levels[_currentLevelIndex] != newLevel) {
+
+				endComponent(_levels[_currentLevelIndex], visitor);
+				_currentLevelIndex++;
+			}
+
+		} else {
+
+			// close one component for each level that we ascend
+			for (Precision level = _currentLevel;; level++) {
+
+				endComponent(level, visitor);
+
+				if (level == newLevel - 1)
+					break;
+			}
+		}
+	}
+
+	// go to the new location
+	_currentLocation = newLocation;
+	_currentLevel    = newLevel;
+
+	// the first time we are here?
+	if (_state[newLocation] == Unvisited) {
+
+		// mark it as visited and add it to the pixel list
+		_state[newLocation] = Visited;
+
+		derived().addLocation(newLocation);
+	}
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::fillLevel(VisitorType& visitor) {
+
+	// we are supposed to fill all adjacent locations of the current location 
+	// that have the same level
+	FillFrame initial = { _currentLevel, _currentLocation, 0 };
+	_fillStack.push_back(initial);
+
+	LOG_ALL(_log) << "filling level " << (int)_currentLevel << std::endl;
+
+	location_type neighborLocation;
+	Precision     neighborLevel;
+
+	// Whenever we find a smaller neighbor, we interrupt filling the current 
+	// level and fill the smaller one first. Instead of recursing, a frame is 
+	// pushed on the fill stack for the smaller level, and popped once it is 
+	// filled.
+	while (!_fillStack.empty()) {
+
+		FillFrame& frame = _fillStack.back();
+
+		bool descended = false;
+
+		// look at all remaining valid neighbors of the current location
+		while (frame.nextDirection < NumNeighbors) {
+
+			Direction direction = frame.nextDirection++;
+
+			// is this a valid neighbor?
+			if (!findNeighbor(direction, neighborLocation, neighborLevel))
+				continue;
+
+			// remember the neighbor location, no matter whether it is lower, 
+			// equal, or higher
+			_boundaryLocations.push(neighborLocation, neighborLevel);
+
+			if (neighborLevel < frame.targetLevel) {
+
+				// remember where we are
+				frame.location = _currentLocation;
+
+				// fill all levels that are lower than our target level
+				if (gotoLowerLevel(frame.targetLevel, visitor)) {
+
+					FillFrame lower = { _currentLevel, _currentLocation, 0 };
+					_fillStack.push_back(lower);
+
+					LOG_ALL(_log) << "filling level " << (int)_currentLevel << std::endl;
+
+					descended = true;
+					break;
+				}
+
+				// go back to where we were
+				gotoLocation(frame.location, visitor);
+			}
+		}
+
+		if (descended)
+			continue;
+
+		// try to find the next non-visited boundary location of the current 
+		// level
+		location_type newLocation;
+		bool found = false;
+		while (_boundaryLocations.pop(frame.targetLevel, newLocation))
+			if (_state[newLocation] == Unvisited) {
+
+				found = true;
+				break;
+			}
+
+		if (found) {
+
+			// we found a not-yet-visited boundary location of the current 
+			// level -- continue filling with it
+			gotoLocation(newLocation, visitor);
+			frame.nextDirection = 0;
+			continue;
+		}
+
+		// there aren't any other boundary locations of the current level, we 
+		// are done with it
+		_fillStack.pop_back();
+
+		if (_fillStack.empty())
+			return;
+
+		// the calling level might have more lower levels to fill (filling 
+		// might have added more than the one it found)
+		FillFrame& caller = _fillStack.back();
+
+		if (gotoLowerLevel(caller.targetLevel, visitor)) {
+
+			FillFrame lower = { _currentLevel, _currentLocation, 0 };
+			_fillStack.push_back(lower);
+
+			LOG_ALL(_log) << "filling level " << (int)_currentLevel << std::endl;
+
+		} else {
+
+			// go back to where the caller was
+			gotoLocation(caller.location, visitor);
+		}
+	}
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+bool
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::gotoHigherLevel(VisitorType& visitor) {
+
+	location_type newLocation;
+	Precision     newLevel;
+
+	bool found = false;
+
+	// find the lowest boundary location higher then the current level that has 
+	// not been visited yet
+	while (_boundaryLocations.popHigher(_currentLevel, newLocation, newLevel))
+		if (_state[newLocation] == Unvisited) {
+
+			found = true;
+			break;
+		}
+
+	if (!found) {
+
+		// There are no more higher levels, we are done. End all the remaining 
+		// open components (which are at least the component for level 
+		// MaxValue, or the highest present level).
+		if (_skipEmptyLevels) {
+
+			for (; _currentLevelIndex < _levels.size(); _currentLevelIndex++)
+				endComponent(_levels[_currentLevelIndex], visitor);
+
+			return false;
+		}
+
+		for (Precision level = _currentLevel;; level++) {
+
+			endComponent(level, visitor);
+
+			if (level == MaxValue)
+				return false;
+		}
+	}
+
+	gotoLocation(newLocation, visitor);
+
+	assert(_currentLevel == newLevel);
+
+	return true;
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+bool
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::gotoLowerLevel(Precision referenceLevel, VisitorType& visitor) {
+
+	location_type newLocation;
+	Precision     newLevel;
+
+	// find the lowest boundary location lower then the reference level that 
+	// has not been visited yet
+	while (_boundaryLocations.popLowest(referenceLevel, newLocation, newLevel))
+		if (_state[newLocation] == Unvisited) {
+
+			gotoLocation(newLocation, visitor);
+			assert(_currentLevel == newLevel);
+			return true;
+		}
+
+	return false;
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::beginComponent(Precision level, VisitorType& visitor) {
+
+	_componentBegins.push_back(std::make_pair(level, derived().reportedList().end()));
+	if (_accumulateAttributes)
+		_attributes.push_back(ComponentAttributes());
+
+	VisitorCallbacks<VisitorType, typename Derived::Visitor, Precision, value_type, list_iterator>::newChild(visitor, level, _discretizer);
+}
+
+template <typename Derived, typename Precision, typename DataType, typename ListType, int NumNeighbors>
+template <typename VisitorType>
+void
+FloodingLevelParser<Derived, Precision, DataType, ListType, NumNeighbors>::endComponent(Precision level, VisitorType& visitor) {
+
+	assert(_componentBegins.size() > 0);
+	assert(_componentBegins.back().first == level);
+
+	list_iterator begin = _componentBegins.back().second;
+	_componentBegins.pop_back();
+
+	ComponentAttributes attributes;
+
+	if (_accumulateAttributes) {
+
+		// the pixels of this component are also pixels of its parent
+		attributes = _attributes.back();
+		_attributes.pop_back();
+		if (!_attributes.empty())
+			_attributes.back().merge(attributes);
+	}
+
+	VisitorCallbacks<VisitorType, typename Derived::Visitor, Precision, value_type, list_iterator>::finalize(
+			visitor,
+			level,
+			_discretizer,
+			begin,
+			derived().reportedList().end(),
+			attributes);
+}
+
+// SparseBoundaryLocations map implementation
+template <typename Precision>
+void
+image_level_parser_detail::SparseBoundaryLocations<Precision>::push(
+		const location_type& location,
+		const Precision      level) {
+
+	_boundaryLocations[level].push(location);
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::SparseBoundaryLocations<Precision>::pop(
+		const Precision level,
+		location_type&  boundaryLocation) {
+
+	typename boundary_locations_type::iterator it = _boundaryLocations.find(level);
+	if (it == _boundaryLocations.end())
+		return false;
+
+	return pop(*it, boundaryLocation);
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::SparseBoundaryLocations<Precision>::pop(
+		typename boundary_locations_type::value_type& val,
+		location_type& boundaryLocation) {
+
+	typename boundary_locations_type::mapped_type& locations = val.second;
+	if (locations.empty())
+		return false;
+
+	boundaryLocation = locations.top();
+	locations.pop();
+
+	return true;
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::SparseBoundaryLocations<Precision>::popLowest(
+		const Precision level,
+		location_type&  boundaryLocation,
+		Precision&      boundaryLevel) {
+
+	for (typename boundary_locations_type::iterator it = _boundaryLocations.begin(); it != _boundaryLocations.end() && (*it).first < level; ++it) {
+
+		if (pop(*it, boundaryLocation)) {
+
+			boundaryLevel = it->first;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::SparseBoundaryLocations<Precision>::popHigher(
+		const Precision level,
+		location_type&  boundaryLocation,
+		Precision&      boundaryLevel) {
+
+	for (typename boundary_locations_type::iterator it = _boundaryLocations.upper_bound(level); it != _boundaryLocations.end(); ++it) {
+
+		if (pop(*it, boundaryLocation)) {
+
+			boundaryLevel = it->first;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+
+template <typename Precision>
+void
+image_level_parser_detail::SparseBoundaryLocations<Precision>::clear() {
+
+	_boundaryLocations.clear();
+}
+
+// DenseBoundaryLocations vector implementation
+template <typename Precision>
+void
+image_level_parser_detail::DenseBoundaryLocations<Precision>::push(
+		const location_type& location,
+		const Precision      level) {
+
+	typename boundary_locations_type::value_type& locations = _boundaryLocations[level];
+
+	if (locations.empty())
+		setNonEmpty(level);
+
+	locations.push_back(location);
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::DenseBoundaryLocations<Precision>::pop(
+		const Precision level,
+		location_type&  boundaryLocation) {
+
+	typename boundary_locations_type::value_type& locations = _boundaryLocations[level];
+
+	if (locations.empty())
+		return false;
+
+	boundaryLocation = locations.back();
+	locations.pop_back();
+
+	if (locations.empty())
+		setEmpty(level);
+
+	return true;
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::DenseBoundaryLocations<Precision>::popLowest(
+		const Precision level,
+		location_type&  boundaryLocation,
+		Precision&      boundaryLevel) {
+
+	size_t lowest;
+
+	if (!findNonEmpty(0, lowest) || lowest >= level)
+		return false;
+
+	boundaryLevel = lowest;
+
+	return pop(boundaryLevel, boundaryLocation);
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::DenseBoundaryLocations<Precision>::popHigher(
+		const Precision level,
+		location_type&  boundaryLocation,
+		Precision&      boundaryLevel) {
+
+	if (level == MAX_LEVEL)
+		return false;
+
+	size_t higher;
+
+	if (!findNonEmpty(static_cast<size_t>(level) + 1, higher))
+		return false;
+
+	boundaryLevel = higher;
+
+	return pop(boundaryLevel, boundaryLocation);
+}
+
+template <typename Precision>
+void
+image_level_parser_detail::DenseBoundaryLocations<Precision>::clear() {
+
+	// only visit the non-empty levels, keep the capacity of each level
+	size_t level;
+	while (findNonEmpty(0, level)) {
+
+		_boundaryLocations[level].clear();
+		setEmpty(level);
+	}
+}
+
+template <typename Precision>
+bool
+image_level_parser_detail::DenseBoundaryLocations<Precision>::findNonEmpty(
+		size_t  from,
+		size_t& level) const {
+
+	size_t word = from/64;
+
+	// remaining levels in the word of 'from'
+	uint64_t bits = _levelBits[word] & (~(uint64_t)0 << (from%64));
+
+	if (bits == 0) {
+
+		// find the next non-zero word, starting with the next one in the 
+		// summary word of 'word'
+		size_t summary = (word + 1)/64;
+
+		if (summary >= _wordBits.size())
+			return false;
+
+		uint64_t words = _wordBits[summary] & (~(uint64_t)0 << ((word + 1)%64));
+
+		while (words == 0) {
+
+			summary++;
+
+			if (summary == _wordBits.size())
+				return false;
+
+			words = _wordBits[summary];
+		}
+
+		word = summary*64 + __builtin_ctzll(words);
+		bits = _levelBits[word];
+	}
+
+	level = word*64 + __builtin_ctzll(bits);
+
+	return true;
+}
+
+#endif // IMAGEPROCESSING_FLOODING_LEVEL_PARSER_H__
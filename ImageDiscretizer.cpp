@@ -0,0 +1,484 @@
+#ifdef __SSE2__
+#include <emmintrin.h> // SSE 2
+#endif // __SSE2__
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h> // AVX 2, enabled per function
+#define IMAGEPROCESSING_DISCRETIZER_AVX2
+#endif
+
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include "ImageDiscretizer.h"
+
+logger::LogChannel imagediscretizerlog("imagediscretizerlog", "[ImageDiscretizer] ");
+
+namespace {
+
+#ifdef IMAGEPROCESSING_DISCRETIZER_AVX2
+
+bool hasAvx2() {
+
+	static const bool avx2 = __builtin_cpu_supports("avx2");
+	return avx2;
+}
+
+#endif // IMAGEPROCESSING_DISCRETIZER_AVX2
+
+/**
+ * Discretize a single value exactly the way the vigra functor expression
+ * does: compute in float, round half up, and clamp to [0, maxValue].
+ */
+template <typename Precision>
+inline Precision
+discretizeValue(float value, float min, float range, float maxValue, bool darkToBright) {
+
+	float d = ((value - min)/range)*maxValue;
+
+	if (!darkToBright)
+		d = maxValue - d;
+
+	if (d <= 0)
+		return 0;
+	if (d >= maxValue)
+		return std::numeric_limits<Precision>::max();
+
+	return static_cast<Precision>(static_cast<double>(d) + 0.5);
+}
+
+template <typename Precision>
+void
+discretizeScalar(
+		const float* values,
+		const float* valuesEnd,
+		float        min,
+		float        range,
+		bool         darkToBright,
+		Precision*   discretized) {
+
+	const float maxValue = std::numeric_limits<Precision>::max();
+
+	for (; values < valuesEnd; values++, discretized++)
+		*discretized = discretizeValue<Precision>(*values, min, range, maxValue, darkToBright);
+}
+
+void
+minmaxScalar(const float* values, const float* valuesEnd, float& min, float& max) {
+
+	for (; values < valuesEnd; values++) {
+
+		min = std::min(min, *values);
+		max = std::max(max, *values);
+	}
+}
+
+#ifdef __SSE2__
+
+/**
+ * Discretize four values. The division is kept (instead of a multiplication
+ * with the reciprocal) to get the same levels as the scalar code. Rounding
+ * half up is done via the truncated value and its fraction, which is exact
+ * in single precision.
+ */
+inline __m128i
+discretizeSse2(__m128 values, __m128 min, __m128 range, __m128 maxValue, bool darkToBright) {
+
+	__m128 d = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(values, min), range), maxValue);
+
+	if (!darkToBright)
+		d = _mm_sub_ps(maxValue, d);
+
+	d = _mm_min_ps(_mm_max_ps(d, _mm_setzero_ps()), maxValue);
+
+	__m128i truncated = _mm_cvttps_epi32(d);
+	__m128  fraction  = _mm_sub_ps(d, _mm_cvtepi32_ps(truncated));
+
+	// the comparison mask is -1 where we round up
+	return _mm_sub_epi32(truncated, _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+}
+
+void
+discretizeSse2(
+		const float*   values,
+		const float*   valuesEnd,
+		float          min,
+		float          range,
+		bool           darkToBright,
+		unsigned char* discretized) {
+
+	const __m128 mins      = _mm_set1_ps(min);
+	const __m128 ranges    = _mm_set1_ps(range);
+	const __m128 maxValues = _mm_set1_ps(std::numeric_limits<unsigned char>::max());
+
+	for (; values + 16 <= valuesEnd; values += 16, discretized += 16) {
+
+		__m128i a = discretizeSse2(_mm_loadu_ps(values),      mins, ranges, maxValues, darkToBright);
+		__m128i b = discretizeSse2(_mm_loadu_ps(values + 4),  mins, ranges, maxValues, darkToBright);
+		__m128i c = discretizeSse2(_mm_loadu_ps(values + 8),  mins, ranges, maxValues, darkToBright);
+		__m128i d = discretizeSse2(_mm_loadu_ps(values + 12), mins, ranges, maxValues, darkToBright);
+
+		_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(discretized),
+				_mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+
+	discretizeScalar(values, valuesEnd, min, range, darkToBright, discretized);
+}
+
+void
+discretizeSse2(
+		const float*    values,
+		const float*    valuesEnd,
+		float           min,
+		float           range,
+		bool            darkToBright,
+		unsigned short* discretized) {
+
+	const __m128 mins      = _mm_set1_ps(min);
+	const __m128 ranges    = _mm_set1_ps(range);
+	const __m128 maxValues = _mm_set1_ps(std::numeric_limits<unsigned short>::max());
+
+	// SSE2 can only pack with signed saturation, so shift the values into
+	// the signed range and back
+	const __m128i shift16 = _mm_set1_epi16(-32768);
+	const __m128i shift32 = _mm_set1_epi32(32768);
+
+	for (; values + 8 <= valuesEnd; values += 8, discretized += 8) {
+
+		__m128i a = discretizeSse2(_mm_loadu_ps(values),     mins, ranges, maxValues, darkToBright);
+		__m128i b = discretizeSse2(_mm_loadu_ps(values + 4), mins, ranges, maxValues, darkToBright);
+
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, shift32), _mm_sub_epi32(b, shift32));
+
+		_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(discretized),
+				_mm_xor_si128(packed, shift16));
+	}
+
+	discretizeScalar(values, valuesEnd, min, range, darkToBright, discretized);
+}
+
+void
+minmaxSse2(const float* values, const float* valuesEnd, float& min, float& max) {
+
+	__m128 mins = _mm_set1_ps(min);
+	__m128 maxs = _mm_set1_ps(max);
+
+	for (; values + 4 <= valuesEnd; values += 4) {
+
+		__m128 v = _mm_loadu_ps(values);
+		mins = _mm_min_ps(mins, v);
+		maxs = _mm_max_ps(maxs, v);
+	}
+
+	float minValues[4], maxValues[4];
+	_mm_storeu_ps(minValues, mins);
+	_mm_storeu_ps(maxValues, maxs);
+
+	minmaxScalar(minValues, minValues + 4, min, max);
+	minmaxScalar(maxValues, maxValues + 4, min, max);
+	minmaxScalar(values, valuesEnd, min, max);
+}
+
+#endif // __SSE2__
+
+#ifdef IMAGEPROCESSING_DISCRETIZER_AVX2
+
+/**
+ * AVX2 version of discretizeSse2 for eight values.
+ */
+__attribute__((target("avx2")))
+inline __m256i
+discretizeAvx2(__m256 values, __m256 min, __m256 range, __m256 maxValue, bool darkToBright) {
+
+	__m256 d = _mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(values, min), range), maxValue);
+
+	if (!darkToBright)
+		d = _mm256_sub_ps(maxValue, d);
+
+	d = _mm256_min_ps(_mm256_max_ps(d, _mm256_setzero_ps()), maxValue);
+
+	__m256i truncated = _mm256_cvttps_epi32(d);
+	__m256  fraction  = _mm256_sub_ps(d, _mm256_cvtepi32_ps(truncated));
+
+	return _mm256_sub_epi32(
+			truncated,
+			_mm256_castps_si256(_mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ)));
+}
+
+__attribute__((target("avx2")))
+void
+discretizeAvx2(
+		const float*   values,
+		const float*   valuesEnd,
+		float          min,
+		float          range,
+		bool           darkToBright,
+		unsigned char* discretized) {
+
+	const __m256 mins      = _mm256_set1_ps(min);
+	const __m256 ranges    = _mm256_set1_ps(range);
+	const __m256 maxValues = _mm256_set1_ps(std::numeric_limits<unsigned char>::max());
+
+	// packing works within 128-bit lanes, this restores the order of the
+	// 32-bit groups afterwards
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	for (; values + 32 <= valuesEnd; values += 32, discretized += 32) {
+
+		__m256i a = discretizeAvx2(_mm256_loadu_ps(values),      mins, ranges, maxValues, darkToBright);
+		__m256i b = discretizeAvx2(_mm256_loadu_ps(values + 8),  mins, ranges, maxValues, darkToBright);
+		__m256i c = discretizeAvx2(_mm256_loadu_ps(values + 16), mins, ranges, maxValues, darkToBright);
+		__m256i d = discretizeAvx2(_mm256_loadu_ps(values + 24), mins, ranges, maxValues, darkToBright);
+
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+
+		_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(discretized),
+				_mm256_permutevar8x32_epi32(packed, order));
+	}
+
+	discretizeScalar(values, valuesEnd, min, range, darkToBright, discretized);
+}
+
+__attribute__((target("avx2")))
+void
+discretizeAvx2(
+		const float*    values,
+		const float*    valuesEnd,
+		float           min,
+		float           range,
+		bool            darkToBright,
+		unsigned short* discretized) {
+
+	const __m256 mins      = _mm256_set1_ps(min);
+	const __m256 ranges    = _mm256_set1_ps(range);
+	const __m256 maxValues = _mm256_set1_ps(std::numeric_limits<unsigned short>::max());
+
+	for (; values + 16 <= valuesEnd; values += 16, discretized += 16) {
+
+		__m256i a = discretizeAvx2(_mm256_loadu_ps(values),     mins, ranges, maxValues, darkToBright);
+		__m256i b = discretizeAvx2(_mm256_loadu_ps(values + 8), mins, ranges, maxValues, darkToBright);
+
+		_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(discretized),
+				_mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8));
+	}
+
+	discretizeScalar(values, valuesEnd, min, range, darkToBright, discretized);
+}
+
+__attribute__((target("avx2")))
+void
+minmaxAvx2(const float* values, const float* valuesEnd, float& min, float& max) {
+
+	__m256 mins = _mm256_set1_ps(min);
+	__m256 maxs = _mm256_set1_ps(max);
+
+	for (; values + 8 <= valuesEnd; values += 8) {
+
+		__m256 v = _mm256_loadu_ps(values);
+		mins = _mm256_min_ps(mins, v);
+		maxs = _mm256_max_ps(maxs, v);
+	}
+
+	float minValues[8], maxValues[8];
+	_mm256_storeu_ps(minValues, mins);
+	_mm256_storeu_ps(maxValues, maxs);
+
+	minmaxScalar(minValues, minValues + 8, min, max);
+	minmaxScalar(maxValues, maxValues + 8, min, max);
+	minmaxScalar(values, valuesEnd, min, max);
+}
+
+#endif // IMAGEPROCESSING_DISCRETIZER_AVX2
+
+template <typename Precision>
+void
+discretizeDispatch(
+		const float* values,
+		size_t       size,
+		float        min,
+		float        range,
+		bool         darkToBright,
+		Precision*   discretized) {
+
+#ifdef IMAGEPROCESSING_DISCRETIZER_AVX2
+	if (hasAvx2()) {
+
+		discretizeAvx2(values, values + size, min, range, darkToBright, discretized);
+		return;
+	}
+#endif
+
+#ifdef __SSE2__
+	discretizeSse2(values, values + size, min, range, darkToBright, discretized);
+#else
+	discretizeScalar(values, values + size, min, range, darkToBright, discretized);
+#endif
+}
+
+/**
+ * Map a float to an unsigned integer with the same order. Negative zero is 
+ * mapped to the key of positive zero, such that equal values have equal keys.
+ */
+inline uint32_t
+sortableKey(float value) {
+
+	if (value == 0)
+		value = 0;
+
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	// negative values: reverse their order by flipping all bits, positive 
+	// values: move them above the negative ones
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+} // anonymous namespace
+
+bool
+image_discretizer_detail::minmax(const float* values, size_t size, float& min, float& max) {
+
+	if (size == 0)
+		return false;
+
+	min = max = values[0];
+
+#ifdef IMAGEPROCESSING_DISCRETIZER_AVX2
+	if (hasAvx2()) {
+
+		minmaxAvx2(values, values + size, min, max);
+		return true;
+	}
+#endif
+
+#ifdef __SSE2__
+	minmaxSse2(values, values + size, min, max);
+#else
+	minmaxScalar(values, values + size, min, max);
+#endif
+
+	return true;
+}
+
+bool
+image_discretizer_detail::discretize(
+		const float*   values,
+		size_t         size,
+		float          min,
+		float          range,
+		bool           darkToBright,
+		unsigned char* discretized) {
+
+	discretizeDispatch(values, size, min, range, darkToBright, discretized);
+	return true;
+}
+
+bool
+image_discretizer_detail::discretize(
+		const float*    values,
+		size_t          size,
+		float           min,
+		float           range,
+		bool            darkToBright,
+		unsigned short* discretized) {
+
+	discretizeDispatch(values, size, min, range, darkToBright, discretized);
+	return true;
+}
+
+bool
+image_discretizer_detail::rank(
+		const float*               values,
+		size_t                     size,
+		std::vector<unsigned int>& ranks,
+		std::vector<float>&        distinctValues) {
+
+	ranks.resize(size);
+	distinctValues.clear();
+
+	if (size == 0)
+		return true;
+
+	std::vector<uint32_t>     keys(size), sortedKeys(size);
+	std::vector<unsigned int> indices(size), sortedIndices(size);
+
+	for (size_t i = 0; i < size; i++) {
+
+		keys[i]    = sortableKey(values[i]);
+		indices[i] = i;
+	}
+
+	// LSD radix sort of the keys (together with their indices) in three 
+	// passes of 11 bits
+	const int    bits       = 11;
+	const size_t numBuckets = 1 << bits;
+	std::vector<size_t> counts(numBuckets);
+
+	for (int shift = 0; shift < 32; shift += bits) {
+
+		std::fill(counts.begin(), counts.end(), 0);
+		for (size_t i = 0; i < size; i++)
+			counts[(keys[i] >> shift) & (numBuckets - 1)]++;
+
+		// all keys in one bucket (e.g., the exponent bits of a probability 
+		// map) -- this pass would not change the order
+		if (counts[(keys[0] >> shift) & (numBuckets - 1)] == size)
+			continue;
+
+		size_t offset = 0;
+		for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+
+			size_t count   = counts[bucket];
+			counts[bucket] = offset;
+			offset        += count;
+		}
+
+		for (size_t i = 0; i < size; i++) {
+
+			size_t pos = counts[(keys[i] >> shift) & (numBuckets - 1)]++;
+			sortedKeys[pos]    = keys[i];
+			sortedIndices[pos] = indices[i];
+		}
+
+		keys.swap(sortedKeys);
+		indices.swap(sortedIndices);
+	}
+
+	// one rank per distinct key
+	for (size_t i = 0; i < size; i++) {
+
+		if (i == 0 || keys[i] != keys[i - 1])
+			distinctValues.push_back(values[indices[i]]);
+
+		ranks[indices[i]] = distinctValues.size() - 1;
+	}
+
+	return true;
+}
+
+bool
+image_discretizer_detail::histogramBins(
+		const float*    values,
+		size_t          size,
+		float           min,
+		float           max,
+		unsigned short* bins) {
+
+	const uint32_t minKey = sortableKey(min);
+	const uint32_t maxKey = sortableKey(max);
+
+	// spread the keys of [min, max] over all bins
+	const double scale = (maxKey > minKey ? 65535.0/(maxKey - minKey) : 0.0);
+
+	for (size_t i = 0; i < size; i++) {
+
+		uint32_t key = sortableKey(std::min(std::max(values[i], min), max));
+		bins[i] = std::min(65535.0, (key - minKey)*scale);
+	}
+
+	return true;
+}
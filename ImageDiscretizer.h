@@ -0,0 +1,502 @@
+#ifndef IMAGEPROCESSING_IMAGE_DISCRETIZER_H__
+#define IMAGEPROCESSING_IMAGE_DISCRETIZER_H__
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include <vigra/multi_array.hxx>
+#include <vigra/multi_pointoperators.hxx>
+#include <vigra/transformimage.hxx>
+#include <vigra/functorexpression.hxx>
+
+#include <util/Logger.h>
+#include "Image.h"
+
+extern logger::LogChannel imagediscretizerlog;
+
+namespace image_discretizer_detail {
+
+	/**
+	 * Vectorized kernels for float images (see ImageDiscretizer.cpp). They 
+	 * return false for value and precision types they don't support, in which 
+	 * case the generic implementation is used.
+	 */
+	bool minmax(const float* values, size_t size, float& min, float& max);
+
+	/**
+	 * Discretize values into [0, max(Precision)] the same way the generic 
+	 * implementation does, i.e., d = (v - min)/range*max(Precision), inverted 
+	 * if not darkToBright, rounded and clamped.
+	 */
+	bool discretize(const float* values, size_t size, float min, float range, bool darkToBright, unsigned char* discretized);
+	bool discretize(const float* values, size_t size, float min, float range, bool darkToBright, unsigned short* discretized);
+
+	/**
+	 * Replace each value by the rank of its value among the distinct values 
+	 * (radix sort on the bits of the floats). The distinct values are stored 
+	 * in increasing order.
+	 */
+	bool rank(const float* values, size_t size, std::vector<unsigned int>& ranks, std::vector<float>& distinctValues);
+
+	/**
+	 * Compute the histogram bin in [0, 2^16) of each value, after clamping it 
+	 * to [min, max]. The bins are monotone in the values. For floats, the bins 
+	 * evenly divide the order-preserving keys of the values between min and 
+	 * max, i.e., their width grows with the magnitude of the values.
+	 */
+	bool histogramBins(const float* values, size_t size, float min, float max, unsigned short* bins);
+
+	template <typename ValueType>
+	bool minmax(const ValueType*, size_t, ValueType&, ValueType&) { return false; }
+
+	template <typename ValueType>
+	bool histogramBins(const ValueType*, size_t, ValueType, ValueType, unsigned short*) { return false; }
+
+	template <typename ValueType>
+	bool rank(const ValueType*, size_t, std::vector<unsigned int>&, std::vector<ValueType>&) { return false; }
+
+	template <typename ValueType, typename Precision>
+	bool discretize(const ValueType*, size_t, ValueType, ValueType, bool, Precision*) { return false; }
+}
+
+/**
+ * Discretizes the intensities of an image into the range of the Precision type 
+ * and maps discretized values back to the original intensities. Used by the 
+ * image parsers to obtain the levels of the pixels. ImageType can also be a 
+ * multi-array of any other dimension (e.g., the data of a volume).
+ */
+template <typename Precision = unsigned char, typename ImageType = IntensityImage>
+class ImageDiscretizer {
+
+public:
+
+	typedef typename ImageType::value_type value_type;
+
+	/**
+	 * Create a new discretizer.
+	 *
+	 * @param darkToBright
+	 *              If false, the image is inverted on-the-fly, such that the 
+	 *              brightest intensity is mapped to the lowest level.
+	 *
+	 * @param minIntensity, maxIntensity
+	 *              The intensity range to map onto the range of Precision. If 
+	 *              both are 0, the range of the image is used.
+	 *
+	 * @param rankTransform
+	 *              Instead of mapping the intensity range linearly, use the 
+	 *              rank of each intensity among the distinct intensities of 
+	 *              the image as its level. This is lossless as long as there 
+	 *              are not more distinct intensities than values of 
+	 *              Precision, and the intensity range is ignored.
+	 *
+	 * @param quantiles
+	 *              Instead of mapping the intensity range linearly, map it such 
+	 *              that each level receives about the same number of pixels 
+	 *              (histogram equalization). Only supported for precisions of 
+	 *              up to 16 bit, ignored if rankTransform is set.
+	 */
+	ImageDiscretizer(
+			bool       darkToBright  = true,
+			value_type minIntensity  = 0,
+			value_type maxIntensity  = 0,
+			bool       rankTransform = false,
+			bool       quantiles     = false) :
+		_darkToBright(darkToBright),
+		_minIntensity(minIntensity),
+		_maxIntensity(maxIntensity),
+		_rankTransform(rankTransform),
+		_quantiles(quantiles),
+		_ranked(false),
+		_min(0),
+		_max(0) {}
+
+	/**
+	 * Discretize the given image into the range defined by Precision.
+	 */
+	template <unsigned int N>
+	void discretize(const ImageType& image, vigra::MultiArray<N, Precision>& discretized) {
+		discretizeImpl(image, discretized, std::is_same<Precision, value_type>());
+	}
+
+	/**
+	 * Get the orignal value that corresponds to the given discretized value.
+	 */
+	value_type getOriginalValue(Precision value) const {
+		return getOriginalValueImpl(value, std::is_same<Precision, value_type>());
+	}
+
+	/**
+	 * The number of levels used by the last discretization, if it was a rank 
+	 * transform. In this case, the levels are 0 to getNumRanks() - 1. Returns 
+	 * 0 otherwise.
+	 */
+	size_t getNumRanks() const { return (_ranked ? _levelValues.size() : 0); }
+
+	/**
+	 * Find the min and max intensity of the given image. Returns false, if the 
+	 * image is empty.
+	 */
+	static bool findRange(const ImageType& image, value_type& min, value_type& max) {
+
+		if (image.size() == 0)
+			return false;
+
+		if (!image_discretizer_detail::minmax(image.data(), image.size(), min, max))
+			image.minmax(&min, &max);
+
+		return true;
+	}
+
+	static const Precision MaxValue;
+
+private:
+
+	// TODO:
+	// The following methods have specializations for when Precision is the
+	// same as ImageType::value_type. These are necessary for, e.g., lossless
+	// label retrieval. Unfortunately there does not seem to be any way to
+	// achieve specialization with enable_if template parameters SFINAE for
+	// methods of a templated class, so of the remaining implementation
+	// strategies overloading is used for clarity.
+
+	template <unsigned int N>
+	void discretizeImpl(const ImageType& image, vigra::MultiArray<N, Precision>& discretized, std::false_type);
+	template <unsigned int N>
+	void discretizeImpl(const ImageType& image, vigra::MultiArray<N, Precision>& discretized, std::true_type);
+
+	/**
+	 * Apply a functor to each value of the image, using the image or the 
+	 * multi-array point operators of vigra, depending on the dimension.
+	 */
+	template <typename Functor>
+	static void transform(const ImageType& image, vigra::MultiArray<2, Precision>& discretized, const Functor& f) {
+		vigra::transformImage(srcImageRange(image), destImage(discretized), f);
+	}
+	template <unsigned int N, typename Functor>
+	static void transform(const ImageType& image, vigra::MultiArray<N, Precision>& discretized, const Functor& f) {
+		vigra::transformMultiArray(srcMultiArrayRange(image), destMultiArray(discretized), f);
+	}
+	static void copy(const ImageType& image, vigra::MultiArray<2, Precision>& discretized) {
+		vigra::copyImage(srcImageRange(image), destImage(discretized));
+	}
+	template <unsigned int N>
+	static void copy(const ImageType& image, vigra::MultiArray<N, Precision>& discretized) {
+		vigra::copyMultiArray(srcMultiArrayRange(image), destMultiArray(discretized));
+	}
+
+	value_type getOriginalValueImpl(Precision value, std::false_type) const;
+	value_type getOriginalValueImpl(Precision value, std::true_type) const;
+
+	/**
+	 * Discretize by the ranks of the intensities. Returns false, if there are 
+	 * too many distinct intensities.
+	 */
+	template <unsigned int N>
+	bool rank(const ImageType& image, vigra::MultiArray<N, Precision>& discretized);
+
+	/**
+	 * Discretize by the quantiles of a histogram of the intensities in [_min, 
+	 * _max].
+	 */
+	template <unsigned int N>
+	void quantiles(const ImageType& image, vigra::MultiArray<N, Precision>& discretized);
+
+	/**
+	 * The histogram bin of the given intensity in quantiles(), for value types 
+	 * without a histogramBins kernel.
+	 */
+	static size_t histogramBin(value_type value, double min, double scale, size_t numBins) {
+
+		double bin = (static_cast<double>(value) - min)*scale;
+
+		if (bin <= 0)
+			return 0;
+		if (bin >= numBins - 1)
+			return numBins - 1;
+
+		return static_cast<size_t>(bin);
+	}
+
+	bool _darkToBright;
+
+	// the requested intensity range
+	value_type _minIntensity, _maxIntensity;
+
+	bool _rankTransform;
+	bool _quantiles;
+
+	// the original intensity of each level after a rank transform or a 
+	// quantile discretization, and whether the last discretization was a 
+	// rank transform
+	std::vector<value_type> _levelValues;
+	bool                    _ranked;
+
+	// min and max value of the original image
+	value_type _min, _max;
+};
+
+template <typename Precision, typename ImageType>
+const Precision ImageDiscretizer<Precision, ImageType>::MaxValue = std::numeric_limits<Precision>::max();
+
+template <typename Precision,
+          typename ImageType>
+template <unsigned int N>
+void
+ImageDiscretizer<Precision, ImageType>::discretizeImpl(
+		const ImageType& image,
+		vigra::MultiArray<N, Precision>& discretized,
+		std::false_type) {
+
+	discretized.reshape(image.shape());
+
+	_levelValues.clear();
+	_ranked = false;
+
+	if (_rankTransform && rank(image, discretized)) {
+
+		_ranked = true;
+		return;
+	}
+
+	if (_minIntensity == 0 && _maxIntensity == 0) {
+
+		findRange(image, _min, _max);
+
+	} else {
+
+		_min = _minIntensity;
+		_max = _maxIntensity;
+	}
+
+	// in case the whole image has the same intensity
+	if (_max - _min == 0) {
+
+		_min = 0;
+		_max = 1;
+	}
+
+	if (_quantiles && !_rankTransform) {
+
+		if (sizeof(Precision) <= 2) {
+
+			quantiles(image, discretized);
+			return;
+		}
+
+		LOG_DEBUG(imagediscretizerlog)
+				<< "quantile discretization is not supported for this precision, "
+				<< "using linear discretization" << std::endl;
+	}
+
+	if (_max - _min > std::numeric_limits<Precision>::max())
+		LOG_ERROR(imagediscretizerlog)
+				<< "provided image has a range of " << (_max - _min)
+				<< ", which does not fit into given precision" << std::endl;
+
+	// single pass with a vectorized kernel, if there is one for our types
+	if (image_discretizer_detail::discretize(
+			image.data(),
+			image.size(),
+			_min,
+			static_cast<value_type>(_max - _min),
+			_darkToBright,
+			discretized.data()))
+		return;
+
+	using namespace vigra::functor;
+
+	if (_darkToBright)
+		transform(
+				image,
+				discretized,
+				// d = (v-min)/(max-min)*MAX
+				( (Arg1()-Param(_min)) / Param(_max-_min) )*vigra::functor::Param(MaxValue));
+	else // invert the image on-the-fly
+		transform(
+				image,
+				discretized,
+				// d = MAX - (v-min)/(max-min)*MAX
+				Param(MaxValue) - ( (Arg1()-Param(_min)) / Param(_max-_min) )*Param(MaxValue));
+}
+
+template <typename Precision,
+          typename ImageType>
+template <unsigned int N>
+void
+ImageDiscretizer<Precision, ImageType>::discretizeImpl(
+		const ImageType& image,
+		vigra::MultiArray<N, Precision>& discretized,
+		std::true_type) {
+
+	discretized.reshape(image.shape());
+
+	LOG_DEBUG(imagediscretizerlog)
+			<< "Requested parser precision and image are same type; "
+			<< "ignoring min and max intensity parameters and using "
+			<< "full precision range" << std::endl;
+
+	_min = std::numeric_limits<Precision>::max();
+	_max = std::numeric_limits<Precision>::max();
+
+	using namespace vigra::functor;
+
+	if (_darkToBright)
+		copy(image, discretized);
+	else // invert the image on-the-fly
+		transform(
+				image,
+				discretized,
+				(Param(_max) - Arg1()) + Param(_min));
+}
+
+template <typename Precision,
+          typename ImageType>
+template <unsigned int N>
+bool
+ImageDiscretizer<Precision, ImageType>::rank(
+		const ImageType& image,
+		vigra::MultiArray<N, Precision>& discretized) {
+
+	std::vector<unsigned int> ranks;
+
+	if (!image_discretizer_detail::rank(image.data(), image.size(), ranks, _levelValues)) {
+
+		_levelValues.assign(image.data(), image.data() + image.size());
+		std::sort(_levelValues.begin(), _levelValues.end());
+		_levelValues.erase(std::unique(_levelValues.begin(), _levelValues.end()), _levelValues.end());
+
+		ranks.resize(image.size());
+		for (size_t i = 0; i < ranks.size(); i++)
+			ranks[i] = std::lower_bound(_levelValues.begin(), _levelValues.end(), image.data()[i]) - _levelValues.begin();
+	}
+
+	if (_levelValues.size() > static_cast<size_t>(MaxValue) + 1) {
+
+		LOG_ERROR(imagediscretizerlog)
+				<< "provided image has " << _levelValues.size()
+				<< " distinct values, which do not fit into given precision "
+				<< "-- falling back to linear discretization" << std::endl;
+
+		_levelValues.clear();
+		return false;
+	}
+
+	LOG_DEBUG(imagediscretizerlog)
+			<< "image has " << _levelValues.size() << " distinct values" << std::endl;
+
+	// invert the order of the levels on-the-fly
+	if (!_darkToBright) {
+
+		std::reverse(_levelValues.begin(), _levelValues.end());
+		for (size_t i = 0; i < ranks.size(); i++)
+			ranks[i] = _levelValues.size() - 1 - ranks[i];
+	}
+
+	std::copy(ranks.begin(), ranks.end(), discretized.data());
+
+	return true;
+}
+
+template <typename Precision,
+          typename ImageType>
+template <unsigned int N>
+void
+ImageDiscretizer<Precision, ImageType>::quantiles(
+		const ImageType& image,
+		vigra::MultiArray<N, Precision>& discretized) {
+
+	const value_type* values = image.data();
+	const size_t      size   = image.size();
+
+	if (size == 0)
+		return;
+
+	// a histogram that is finer than the levels
+	const size_t numBins = 1 << 16;
+
+	std::vector<unsigned short> bins(size);
+	if (!image_discretizer_detail::histogramBins(values, size, _min, _max, bins.data())) {
+
+		const double min   = _min;
+		const double scale = (numBins - 1)/(static_cast<double>(_max) - min);
+
+		for (size_t i = 0; i < size; i++)
+			bins[i] = histogramBin(values[i], min, scale, numBins);
+	}
+
+	std::vector<size_t> counts(numBins, 0);
+	for (size_t i = 0; i < size; i++)
+		counts[bins[i]]++;
+
+	// the level of each bin is the fraction of pixels in lower bins, which is 
+	// monotone in the intensity
+	std::vector<Precision> binLevels(numBins);
+	uint64_t below = 0;
+	for (size_t bin = 0; bin < numBins; bin++) {
+
+		uint64_t level = std::min<uint64_t>(MaxValue, (below*(static_cast<uint64_t>(MaxValue) + 1))/size);
+
+		binLevels[bin] = (_darkToBright ? level : MaxValue - level);
+		below += counts[bin];
+	}
+
+	// Remember the intensity that bounds each level, i.e., the largest (or 
+	// smallest, if inverted) intensity that was mapped to it. The component 
+	// of a level contains exactly the pixels up to this intensity.
+	_levelValues.assign(static_cast<size_t>(MaxValue) + 1, _darkToBright ? _min : _max);
+	std::vector<bool> present(static_cast<size_t>(MaxValue) + 1, false);
+
+	for (size_t i = 0; i < size; i++) {
+
+		Precision level = binLevels[bins[i]];
+		discretized.data()[i] = level;
+
+		if (!present[level] ||
+		    ( _darkToBright && values[i] > _levelValues[level]) ||
+		    (!_darkToBright && values[i] < _levelValues[level])) {
+
+			_levelValues[level] = values[i];
+			present[level] = true;
+		}
+	}
+
+	// empty levels have the same components as the next lower level
+	for (size_t level = 1; level < _levelValues.size(); level++)
+		if (!present[level])
+			_levelValues[level] = _levelValues[level - 1];
+}
+
+template <typename Precision,
+          typename ImageType>
+typename ImageDiscretizer<Precision, ImageType>::value_type
+ImageDiscretizer<Precision, ImageType>::getOriginalValueImpl(Precision value, std::false_type) const {
+
+	// levels above the highest rank contain all pixels
+	if (!_levelValues.empty())
+		return _levelValues[std::min(static_cast<size_t>(value), _levelValues.size() - 1)];
+
+	if (_darkToBright)
+		// v = (d/MAX)*(max-min)+min
+		return (static_cast<value_type>(value)/MaxValue)*(_max - _min) + _min;
+	else
+		// v = ((MAX-d)/MAX)*(max-min)+min
+		return (static_cast<value_type>(MaxValue - value)/MaxValue)*(_max - _min) + _min;
+}
+
+template <typename Precision,
+          typename ImageType>
+typename ImageDiscretizer<Precision, ImageType>::value_type
+ImageDiscretizer<Precision, ImageType>::getOriginalValueImpl(Precision value, std::true_type) const {
+
+	if (_darkToBright)
+		return value;
+	else
+		return (std::numeric_limits<Precision>::max() - value) + std::numeric_limits<Precision>::min();
+}
+
+#endif // IMAGEPROCESSING_IMAGE_DISCRETIZER_H__
+
@@ -1,184 +1,22 @@
 #ifndef IMAGEPROCESSING_IMAGE_LEVEL_PARSER_H__
 #define IMAGEPROCESSING_IMAGE_LEVEL_PARSER_H__
 
-#include <stack>
+#include <vector>
+#include <algorithm>
 #include <type_traits>
 #include <limits>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
-#include <boost/container/flat_map.hpp>
-
-#include <vigra/transformimage.hxx>
-#include <vigra/functorexpression.hxx>
 
 #include <util/Logger.h>
 #include "PixelList.h"
 #include "Image.h"
+#include "ImageDiscretizer.h"
+#include "FloodingLevelParser.h"
+#include "exceptions.h"
 
 extern logger::LogChannel imagelevelparserlog;
 
-namespace image_level_parser_detail {
-
-	template <typename Precision>
-	class BoundaryLocations {
-
-	public:
-
-		typedef util::point<unsigned int,2> point_type;
-
-		/**
-		 * Put a boundary location with its level on the stack of open boundary
-		 * locations.
-		 */
-		virtual void push(
-				const point_type& location,
-				const Precision   level) = 0;
-
-		/**
-		 * Get the next open boundary location with the given level. Returns
-		 * false if there is none.
-		 *
-		 * @param level
-		 *              The reference level.
-		 *
-		 * @param boundaryLocation
-		 *              [out] The next boundary location with level smaller then
-		 *              level.
-		 */
-		virtual bool pop(
-				const Precision level,
-				point_type&     boundaryLocation) = 0;
-
-		/**
-		 * Get the lowest open boundary location that has a level smaller than
-		 * the given level.
-		 *
-		 * @param level
-		 *              The reference level.
-		 *
-		 * @param boundaryLocation
-		 *              [out] The lowest boundary location with level smaller
-		 *              then level.
-		 *
-		 * @param boundaryLevel
-		 *              [out] The level of the found boundary location.
-		 *
-		 * @return true, if there is such a boundary location
-		 */
-		virtual bool popLowest(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel) = 0;
-
-		/**
-		 * Get the next open boundary location that has a level higher than the
-		 * given level.
-		 *
-		 * @param level
-		 *              The reference level.
-		 *
-		 * @param boundaryLocation
-		 *              [out] The next boundary location with level higher then
-		 *              level.
-		 *
-		 * @param boundaryLevel
-		 *              [out] The level of the found boundary location.
-		 *
-		 * @return true, if there is such a boundary location
-		 */
-		virtual bool popHigher(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel) = 0;
-	};
-
-	template <typename Precision>
-	class DenseBoundaryLocations : BoundaryLocations<Precision> {
-
-	public:
-
-		typedef typename BoundaryLocations<Precision>::point_type point_type;
-
-		DenseBoundaryLocations(Precision maxValue) :
-			_boundaryLocations(maxValue + 1),
-			MAX_LEVEL(maxValue) {}
-
-		void push(
-				const point_type& location,
-				const Precision   level);
-
-		bool pop(
-				const Precision level,
-				point_type&     boundaryLocation);
-
-		bool popLowest(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel);
-
-		bool popHigher(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel);
-
-	private:
-		typedef std::vector<std::stack<point_type> > boundary_locations_type;
-
-		boundary_locations_type _boundaryLocations;
-
-		const Precision MAX_LEVEL;
-	};
-
-	template <typename Precision>
-	class SparseBoundaryLocations : BoundaryLocations<Precision> {
-
-	public:
-
-		typedef typename BoundaryLocations<Precision>::point_type point_type;
-
-		SparseBoundaryLocations(Precision maxValue) {
-			_boundaryLocations.reserve(std::min<size_t>({(size_t)maxValue + 1, 1024, 1<<(sizeof(Precision))}));
-		}
-
-		void push(
-				const point_type& location,
-				const Precision   level);
-
-		bool pop(
-				const Precision level,
-				point_type&     boundaryLocation);
-
-		bool popLowest(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel);
-
-		bool popHigher(
-				const Precision level,
-				point_type&     boundaryLocation,
-				Precision&      boundaryLevel);
-
-	private:
-		typedef boost::container::flat_map<Precision, std::stack<point_type> > boundary_locations_type;
-
-		bool pop(
-			typename boundary_locations_type::value_type& val,
-			point_type& boundaryLocation);
-
-		boundary_locations_type _boundaryLocations;
-	};
-
-	template <typename Precision>
-	struct Traits {
-		typedef SparseBoundaryLocations<Precision> boundary_locations_type;
-	};
-
-	template <>
-	struct Traits<unsigned char> {
-		typedef DenseBoundaryLocations<unsigned char> boundary_locations_type;
-	};
-}
-
 /**
  * Parses the pixels of an image in terms of the connected components of varying 
  * intensity thresholds in linear time. For each connected component and each 
@@ -188,9 +26,18 @@ namespace image_level_parser_detail {
  * The input image is discretized into the range of Precision, and all possible 
  * thresholds are applied (for example, unsigned char corresponds to 255 
  * thresholds).
+ *
+ * The flooding itself is implemented in FloodingLevelParser, this class sets 
+ * up the padded image and fills the pixel lists.
  */
-template <typename Precision = unsigned char, typename ImageType = IntensityImage>
-class ImageLevelParser {
+template <typename Precision = unsigned char, typename ImageType = IntensityImage, int Connectivity = 4>
+class ImageLevelParser : public FloodingLevelParser<ImageLevelParser<Precision, ImageType, Connectivity>, Precision, ImageType, PixelList, Connectivity> {
+
+	static_assert(Connectivity == 4 || Connectivity == 8, "only 4- and 8-connectivity are supported");
+
+	typedef FloodingLevelParser<ImageLevelParser<Precision, ImageType, Connectivity>, Precision, ImageType, PixelList, Connectivity> Flooding;
+
+	friend Flooding;
 
 public:
 
@@ -199,7 +46,7 @@ public:
 	 */
 	struct Parameters {
 
-		Parameters() : darkToBright(true), minIntensity(0), maxIntensity(0), spacedEdgeImage(false) {}
+		Parameters() : darkToBright(true), minIntensity(0), maxIntensity(0), spacedEdgeImage(false), skipEmptyLevels(false), rankTransform(false), quantiles(false) {}
 
 		// start processing the dark regions
 		bool darkToBright;
@@ -226,6 +73,35 @@ public:
 		 * locations (2x, 2y) and are stored as (x,y).
 		 */
 		bool spacedEdgeImage;
+
+		/**
+		 * Only begin and end components at levels that are actually present 
+		 * in the (discretized) image. Components of levels without pixels are 
+		 * identical to the component of the next lower present level, so this 
+		 * does not change the set of extracted components. However, 
+		 * newChildComponent and finalizeComponent are no longer invoked for 
+		 * every level in the range of Precision, which makes the parse cost 
+		 * scale with the number of distinct levels in the image.
+		 */
+		bool skipEmptyLevels;
+
+		/**
+		 * Use the ranks of the distinct intensities of the image as levels 
+		 * instead of a linear mapping of the intensity range (see 
+		 * ImageDiscretizer). The thresholds are then the exact intensities 
+		 * of the image, and the parse cost depends on the number of distinct 
+		 * intensities only. Implies skipEmptyLevels.
+		 */
+		bool rankTransform;
+
+		/**
+		 * Discretize the intensities such that each level receives about the 
+		 * same number of pixels, instead of mapping the intensity range 
+		 * linearly (see ImageDiscretizer). This preserves the resolution of 
+		 * the thresholds for skewed intensity distributions, e.g., of 
+		 * probability maps, with few levels.
+		 */
+		bool quantiles;
 	};
 
 	/**
@@ -275,6 +151,33 @@ public:
 				typename ImageType::value_type value,
 				PixelList::const_iterator      begin,
 				PixelList::const_iterator      end) {}
+
+		/*
+		 * Visitors can alternatively implement
+		 *
+		 *   void finalizeComponent(
+		 *       typename ImageType::value_type value,
+		 *       PixelList::const_iterator      begin,
+		 *       PixelList::const_iterator      end,
+		 *       const ComponentAttributes&     attributes);
+		 *
+		 * to receive the attributes of the current component, which are then 
+		 * accumulated by the parser while extracting the components.
+		 *
+		 * Visitors that only need the discretized levels can implement
+		 *
+		 *   void newChildLevel(Precision level);
+		 *   void finalizeLevel(
+		 *       Precision                 level,
+		 *       PixelList::const_iterator begin,
+		 *       PixelList::const_iterator end[,
+		 *       const ComponentAttributes& attributes]);
+		 *
+		 * instead, which saves the conversion of each level into its original 
+		 * value (see getOriginalValue()). Callbacks are selected at compile 
+		 * time (see VisitorCallbacks), and the no-op newChildComponent of this 
+		 * class is never invoked.
+		 */
 	};
 
 	/**
@@ -283,6 +186,42 @@ public:
 	 */
 	ImageLevelParser(const ImageType& image, const Parameters& parameters = Parameters());
 
+	/**
+	 * Create a new image level parser for the spaced edge image of the given 
+	 * image and edges, without the need to create the spaced edge image (see 
+	 * Parameters::spacedEdgeImage). The spaced edge image is parsed with the 
+	 * pixels of the image at the even locations, the horizontal edges between 
+	 * pixels (x,y) and (x+1,y) at (2x+1,2y), and the vertical edges between 
+	 * pixels (x,y) and (x,y+1) at (2x,2y+1). The corner (2x+1,2y+1) is 
+	 * reached at the highest level of its four edges. The pixel list contains 
+	 * the pixels of the image only.
+	 *
+	 * @param horizontalEdges
+	 *              An image of size (width - 1)x(height).
+	 *
+	 * @param verticalEdges
+	 *              An image of size (width)x(height - 1).
+	 */
+	ImageLevelParser(
+			const ImageType&  image,
+			const ImageType&  horizontalEdges,
+			const ImageType&  verticalEdges,
+			const Parameters& parameters = Parameters());
+
+	/**
+	 * Prepare this parser for parsing another image, optionally with 
+	 * different parameters. Buffers are reused if the new image has the same 
+	 * shape as the previous one. The pixel list is only reused if no visitor 
+	 * holds on to it anymore; otherwise a new one is created.
+	 */
+	void reset(const ImageType& image);
+	void reset(const ImageType& image, const Parameters& parameters);
+	void reset(
+			const ImageType&  image,
+			const ImageType&  horizontalEdges,
+			const ImageType&  verticalEdges,
+			const Parameters& parameters);
+
 	/**
 	 * Parse the image. The provided visitor has to implement the interface of 
 	 * Visitor (but does not need to inherit from it).
@@ -298,813 +237,545 @@ public:
 	template <typename VisitorType>
 	void parse(VisitorType& visitor);
 
+	/**
+	 * Get the original value that corresponds to the given level, e.g., for 
+	 * visitors that receive levels instead of values.
+	 */
+	typename ImageType::value_type getOriginalValue(Precision level) const {
+		return _discretizer.getOriginalValue(level);
+	}
+
 private:
 
-	typedef util::point<unsigned int,2> point_type;
+	typedef typename Flooding::location_type location_type;
+
+	using Flooding::MaxValue;
+	using Flooding::Unvisited;
+	using Flooding::Border;
+	using Flooding::_discretizer;
+	using Flooding::_paddedLevels;
+	using Flooding::_state;
+	using Flooding::_neighborOffsets;
+	using Flooding::_levels;
+	using Flooding::_skipEmptyLevels;
+	using Flooding::_attributes;
+	using Flooding::_accumulateAttributes;
 
 	/**
-	 * Set the current location and level.
+	 * Copy the discretized image into the padded image and initialize the 
+	 * state of each location.
 	 */
-	template <typename VisitorType>
-	void gotoLocation(const point_type& location, VisitorType& visitor);
+	void padImage();
 
 	/**
-	 * Fill the level at the current location. Returns true, if the level is 
-	 * bounded (only higher levels surround it); otherwise false.
+	 * Discretize the image and its edges into the padded spaced edge image 
+	 * and initialize the state of each location.
 	 */
-	template <typename VisitorType>
-	void fillLevel(VisitorType& visitor);
+	void padSpacedEdgeImage(
+			const ImageType& image,
+			const ImageType& horizontalEdges,
+			const ImageType& verticalEdges);
 
 	/**
-	 * In the current boundary locations, try to find the lowest level that is 
-	 * higher than the current level and go there. If such a level exists, all 
-	 * the open components until this level are closed (and the visitor 
-	 * informed) and true is returned. Otherwise, all remaining open components 
-	 * are closed (including the one for MaxValue) and false is returned.
+	 * Resize the padded image and the states for an image of the given 
+	 * height and the current stride, and set the neighbor offsets.
 	 */
-	template <typename VisitorType>
-	bool gotoHigherLevel(VisitorType& visitor);
+	void initPaddedImage(unsigned int height);
 
 	/**
-	 * In the current boundary locations, try to find the lowest level that is 
-	 * lower than the reference level and go there. If such a level exists, true 
-	 * is returned.
+	 * The location of pixel (x, y) of the original image in the padded spaced 
+	 * edge image, i.e., of (2x, 2y) plus the border.
 	 */
-	template <typename VisitorType>
-	bool gotoLowerLevel(Precision referenceLevel, VisitorType& visitor);
+	inline size_t spacedLocation(unsigned int x, unsigned int y) const {
+
+		return static_cast<size_t>(2*y + 1)*_stride + 2*x + 1;
+	}
 
 	/**
-	 * Begin a new connected component at the current location for the given 
-	 * level.
+	 * Set the level of the border locations to a level that is present in the 
+	 * image, such that the levels can be collected from the whole padded 
+	 * image.
 	 */
-	template <typename VisitorType>
-	void beginComponent(Precision level, VisitorType& visitor);
+	void fillBorder();
 
 	/**
-	 * End a connected component at the current location.
-	 *
-	 * @return The begin and end iterator of the new connected component in the 
-	 * pixel list.
+	 * Add the pixel at the given location to the pixel lists (see 
+	 * FloodingLevelParser).
 	 */
-	template <typename VisitorType>
-	void endComponent(Precision level, VisitorType& visitor);
+	void addLocation(location_type location);
 
 	/**
-	 * Find the neighbor of the current position in the given direction. Returns 
-	 * false, if the neighbor is not valid (out of bounds or already visited).  
-	 * Otherwise, neighborLocation and neighborLevel are set and true is 
-	 * returned.
+	 * The pixel list that is passed to the visitor (see FloodingLevelParser).
 	 */
-	typedef unsigned char Direction;
-	static const Direction Right;
-	static const Direction Down;
-	static const Direction Left;
-	static const Direction Up;
-	bool findNeighbor(Direction direction, point_type& neighborLocation, Precision& neighborLevel);
-
-	// TODO:
-	// The following methods have specializations for when Precision is the
-	// same as ImageType::value_type. These are necessary for, e.g., lossless
-	// label retrieval. Unfortunately there does not seem to be any way to
-	// achieve specialization with enable_if template parameters SFINAE for
-	// methods of a templated class, so of the remaining implementation
-	// strategies overloading is used for clarity.
+	const PixelList& reportedList() const {
+
+		return (_parameters.spacedEdgeImage ? *_condensedPixelList : *_pixelList);
+	}
 
 	/**
 	 * Discretized the input image into the range defined by Precision.
 	 */
 	void discretizeImage(const ImageType& image) {
-		discretizeImageImpl(image, std::is_same<Precision, typename ImageType::value_type>());
+		_discretizer.discretize(image, _image);
 	}
-	void discretizeImageImpl(const ImageType& image, std::false_type);
-	void discretizeImageImpl(const ImageType& image, std::true_type);
 
 	/**
-	 * Get the orignal value that corresponds to the given discretized value.
+	 * Begin a reset for an image of the given shape. Returns true, if the 
+	 * pixel list can be reused.
 	 */
-	typename ImageType::value_type getOriginalValue(Precision value) {
-		return getOriginalValueImpl(value, std::is_same<Precision, typename ImageType::value_type>());
-	}
-	typename ImageType::value_type getOriginalValueImpl(Precision value, std::false_type);
-	typename ImageType::value_type getOriginalValueImpl(Precision value, std::true_type);
+	bool initReset(const ImageType& image, const Parameters& parameters, bool spacedEdges);
 
-	static const Precision MaxValue;
+	/**
+	 * Clear the stacks of the parsing algorithm and collect the levels after 
+	 * the padded image has been set up.
+	 */
+	void finishReset();
+
+	/**
+	 * Collect the sorted list of levels that are present in the discretized 
+	 * image.
+	 */
+	void collectLevels() {
 
-	// discretized version of the input image
+		// after a rank transform, all levels up to the number of ranks are 
+		// present
+		if (_discretizer.getNumRanks() > 0) {
+
+			_levels.resize(_discretizer.getNumRanks());
+			for (size_t level = 0; level < _levels.size(); level++)
+				_levels[level] = level;
+
+			return;
+		}
+
+		collectLevelsImpl(std::integral_constant<bool, sizeof(Precision) <= 2>());
+	}
+	void collectLevelsImpl(std::true_type);
+	void collectLevelsImpl(std::false_type);
+
+	// discretized version of the input image (or of the last discretized 
+	// part of it, for separate edge images)
 	vigra::MultiArray<2, Precision> _image;
 
-	// min and max value of the original image
-	typename ImageType::value_type _min, _max;
+	// the shape of the image of the last reset, and whether it came with 
+	// separate edge images
+	typename ImageType::difference_type _shape;
+	bool                                _spacedEdges;
 
 	// parameters of the parsing algorithm
 	Parameters _parameters;
 
-	// the current location of the parsing algorithm
-	point_type _currentLocation;
-	Precision  _currentLevel;
-	bool       _initCurrentLevel; // Indicates initializing the current level, since we cannot express MaxValue + 1
-
 	// the pixel list, shared ownership with visitors
 	boost::shared_ptr<PixelList> _pixelList;
 
 	// a seperate pixel list to transparently handle the spacedEdgeImage flag
 	boost::shared_ptr<PixelList> _condensedPixelList;
 
-	// stacks of open boundary locations
-	typename image_level_parser_detail::Traits<Precision>::boundary_locations_type _boundaryLocations;
-
-	// stack of component begin iterators (with the level they have been 
-	// generated for)
-	std::stack<std::pair<Precision, PixelList::iterator> > _componentBegins;
-	// another one for the condensed pixel list
-	std::stack<std::pair<Precision, PixelList::iterator> > _condensedComponentBegins;
-
-	// visited flag for each pixel
-	vigra::MultiArray<2, bool> _visited;
+	// the width of a row of the padded image, which stores the discretized 
+	// image with a border of one pixel row by row (the neighbor offsets are 
+	// in the order right, down, left, up, followed by the diagonal neighbors 
+	// for 8-connectivity)
+	unsigned int _stride;
 };
 
-template <typename Precision, typename ImageType>
-const Precision ImageLevelParser<Precision, ImageType>::MaxValue = std::numeric_limits<Precision>::max();
-template <typename Precision, typename ImageType>
-const typename ImageLevelParser<Precision, ImageType>::Direction ImageLevelParser<Precision, ImageType>::Right = 0;
-template <typename Precision, typename ImageType>
-const typename ImageLevelParser<Precision, ImageType>::Direction ImageLevelParser<Precision, ImageType>::Down  = 1;
-template <typename Precision, typename ImageType>
-const typename ImageLevelParser<Precision, ImageType>::Direction ImageLevelParser<Precision, ImageType>::Left  = 2;
-template <typename Precision, typename ImageType>
-const typename ImageLevelParser<Precision, ImageType>::Direction ImageLevelParser<Precision, ImageType>::Up    = 3;
-
-template <typename Precision, typename ImageType>
-ImageLevelParser<Precision, ImageType>::ImageLevelParser(const ImageType& image, const Parameters& parameters) :
-	_parameters(parameters),
-	_initCurrentLevel(false),
-	_pixelList(boost::make_shared<PixelList>(image.size())),
-	_boundaryLocations(MaxValue) {
-
-	if (_parameters.spacedEdgeImage)
-		_condensedPixelList = boost::make_shared<PixelList>(image.size()/4);
+template <typename Precision, typename ImageType, int Connectivity>
+ImageLevelParser<Precision, ImageType, Connectivity>::ImageLevelParser(const ImageType& image, const Parameters& parameters) :
+	Flooding(imagelevelparserlog),
+	_spacedEdges(false),
+	_parameters(parameters) {
 
-	_visited.reshape(image.shape());
-	_visited = false;
-
-	LOG_ALL(imagelevelparserlog) << "initializing for image of size " << image.size() << std::endl;
+	reset(image, parameters);
+}
 
-	this->discretizeImage(image);
+template <typename Precision, typename ImageType, int Connectivity>
+ImageLevelParser<Precision, ImageType, Connectivity>::ImageLevelParser(
+		const ImageType&  image,
+		const ImageType&  horizontalEdges,
+		const ImageType&  verticalEdges,
+		const Parameters& parameters) :
+	Flooding(imagelevelparserlog),
+	_spacedEdges(false),
+	_parameters(parameters) {
+
+	reset(image, horizontalEdges, verticalEdges, parameters);
 }
 
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-ImageLevelParser<Precision, ImageType>::parse(VisitorType& visitor) {
-
-	LOG_ALL(imagelevelparserlog) << "parsing image" << std::endl;
-
-	if (_parameters.spacedEdgeImage)
-		visitor.setPixelList(_condensedPixelList);
-	else
-		visitor.setPixelList(_pixelList);
-
-	// Pretend we come from level MaxValue + 1...
-	_currentLevel = MaxValue;
-	_initCurrentLevel = true;
-
-	// ...and go to our initial pixel. This way we make sure enough components 
-	// are put on the stack.
-	gotoLocation(point_type(0, 0), visitor);
-
-	LOG_ALL(imagelevelparserlog)
-			<< "starting at " << _currentLocation
-			<< " with level " << (int)_currentLevel
-			<< std::endl;
+ImageLevelParser<Precision, ImageType, Connectivity>::reset(const ImageType& image) {
 
-	// loop through the image
-	while (true) {
-
-		// fill the current level
-		fillLevel(visitor);
-
-		//LOG_ALL(imagelevelparserlog)
-				//<< "filled current level"
-				//<< std::endl;
-
-		// try go to the smallest higher level, according to our open 
-		// boundary list
-		if (!gotoHigherLevel(visitor)) {
-
-			//LOG_ALL(imagelevelparserlog)
-					//<< "there are no more higher levels -- we are done"
-					//<< std::endl;
-
-			// if there are no higher levels, we are done
-			return;
-		}
-	}
+	reset(image, _parameters);
 }
 
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-ImageLevelParser<Precision, ImageType>::gotoLocation(const point_type& newLocation, VisitorType& visitor) {
+ImageLevelParser<Precision, ImageType, Connectivity>::reset(const ImageType& image, const Parameters& parameters) {
 
-	Precision newLevel = _image(newLocation.x(), newLocation.y());
-
-	// if we descend
-	if (_currentLevel > newLevel || _initCurrentLevel) {
+	LOG_ALL(imagelevelparserlog) << "initializing for image of size " << image.size() << std::endl;
 
-		// begin a new component for each level that we descend
-		for (Precision level = _currentLevel - (_initCurrentLevel ? 0 : 1);; level--) {
+	bool sameShape = initReset(image, parameters, false);
 
-			_initCurrentLevel = false;
+	_discretizer = ImageDiscretizer<Precision, ImageType>(
+			parameters.darkToBright,
+			parameters.minIntensity,
+			parameters.maxIntensity,
+			parameters.rankTransform,
+			parameters.quantiles);
 
-			beginComponent(level, visitor);
+	_stride = image.width() + 2;
 
-			if (level == newLevel)
-				break;
-		}
+	// Reuse the pixel lists only if nobody else is using them. The pixel list 
+	// stores linear indices with the stride of the padded image, such that 
+	// they can be obtained from locations with a single subtraction.
+	if (sameShape && _pixelList.unique())
+		_pixelList->clear();
+	else
+		_pixelList = boost::make_shared<PixelList>(image.size(), _stride);
 
-	// if we ascend
-	} else if (_currentLevel < newLevel) {
+	// the condensed image contains all even locations of the spaced edge 
+	// image
+	if (_parameters.spacedEdgeImage) {
 
-		// close one component for each level that we ascend
-		for (Precision level = _currentLevel;; level++) {
+		if (sameShape && _condensedPixelList && _condensedPixelList.unique())
+			_condensedPixelList->clear();
+		else
+			_condensedPixelList = boost::make_shared<PixelList>(
+					((image.width() + 1)/2)*((image.height() + 1)/2),
+					(image.width() + 1)/2);
 
-			endComponent(level, visitor);
+	} else {
 
-			if (level == newLevel - 1)
-				break;
-		}
+		_condensedPixelList.reset();
 	}
 
-	// go to the new location
-	_currentLocation = newLocation;
-	_currentLevel    = newLevel;
-
-	// the first time we are here?
-	if (!_visited(newLocation.x(), newLocation.y())) {
-
-		// mark it as visited and add it to the pixel list
-		_visited(newLocation.x(), newLocation.y()) = true;
-
-		if (_parameters.spacedEdgeImage)
-			if (newLocation.x() % 2 == 0 && newLocation.y() % 2 == 0)
-				_condensedPixelList->add(newLocation/2);
+	this->discretizeImage(image);
+	this->padImage();
 
-		_pixelList->add(newLocation);
-	}
+	finishReset();
 }
 
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-ImageLevelParser<Precision, ImageType>::fillLevel(VisitorType& visitor) {
-
-	// we are supposed to fill all adjacent pixels of the current pixel that 
-	// have the same level
-	Precision targetLevel = _currentLevel;
-
-	LOG_ALL(imagelevelparserlog) << "filling level " << (int)targetLevel << std::endl;
-
-	point_type neighborLocation;
-	Precision  neighborLevel;
-
-	// walk around...
-	while (true) {
-
-		//LOG_ALL(imagelevelparserlog) << "I am at " << _currentLocation << 
-		//std::endl;
-
-		// look at all valid neighbors
-		for (Direction direction = 0; direction < 4; direction++) {
-
-			// is this a valid neighbor?
-			if (!findNeighbor(direction, neighborLocation, neighborLevel))
-				continue;
+ImageLevelParser<Precision, ImageType, Connectivity>::reset(
+		const ImageType&  image,
+		const ImageType&  horizontalEdges,
+		const ImageType&  verticalEdges,
+		const Parameters& parameters) {
 
-			if (neighborLevel < targetLevel) {
+	const unsigned int width  = image.width();
+	const unsigned int height = image.height();
 
-				// We found a smaller neighbor. Interrupt filling the current 
-				// level and fill the smaller one first.
+	if (horizontalEdges.width() != std::max(width, 1u) - 1 || horizontalEdges.height() != height ||
+	    verticalEdges.width()   != width || verticalEdges.height() != std::max(height, 1u) - 1)
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"edge images of size " << horizontalEdges.width() << "x" << horizontalEdges.height() <<
+				" and " << verticalEdges.width() << "x" << verticalEdges.height() <<
+				" do not fit an image of size " << width << "x" << height);
 
-				//LOG_ALL(imagelevelparserlog)
-						//<< "neighbor is smaller (" << (int)neighborLevel
-						//<< "), will go down" << std::endl;
+	LOG_ALL(imagelevelparserlog) << "initializing for image of size " << image.size() << " with separate edges" << std::endl;
 
-				// remember where we are
-				point_type currentLocation = _currentLocation;
+	bool sameShape = initReset(image, parameters, true);
 
-				// remember the lower neighbor location
-				_boundaryLocations.push(neighborLocation, neighborLevel);
+	// the pixel list is condensed already
+	_parameters.spacedEdgeImage = false;
 
-				// fill all levels that are lower than our target level (calls 
-				// to fillLevel might add more then the one we just found)
-				while (gotoLowerLevel(targetLevel, visitor))
-					fillLevel(visitor);
+	// the levels of the image and its edges have to be comparable, which is 
+	// not the case for ranks or quantiles of the individual images
+	if (_parameters.rankTransform || _parameters.quantiles) {
 
-				// go back to where we were
-				gotoLocation(currentLocation, visitor);
-
-			} else if (neighborLevel > targetLevel) {
-
-				//LOG_ALL(imagelevelparserlog)
-						//<< "neighbor is larger (" << (int)neighborLevel
-						//<< "), will remember it" << std::endl;
-
-				// we found a larger neighbor -- remember it
-				_boundaryLocations.push(neighborLocation, neighborLevel);
-
-			} else {
-
-				//LOG_ALL(imagelevelparserlog)
-						//<< "neighbor is equal (" << (int)neighborLevel
-						//<< "), will remember it" << std::endl;
-
-				// we found an equal neighbor -- remember it
-				_boundaryLocations.push(neighborLocation, neighborLevel);
-			}
-		}
-
-		// try to find the next non-visited boundary location of the current 
-		// level
-		while (true) {
+		LOG_ERROR(imagelevelparserlog)
+				<< "rank transform and quantiles are not supported for separate "
+				<< "edge images, using linear discretization" << std::endl;
 
-			point_type newLocation;
-			bool found = _boundaryLocations.pop(targetLevel, newLocation);
+		_parameters.rankTransform = false;
+		_parameters.quantiles     = false;
+	}
 
-			// if there aren't any other boundary locations of the current 
-			// level, we are done and bounded
-			if (!found) {
+	// discretize all of them with the same intensity range
+	typename ImageType::value_type minIntensity = parameters.minIntensity;
+	typename ImageType::value_type maxIntensity = parameters.maxIntensity;
 
-				//LOG_ALL(imagelevelparserlog)
-						//<< "no more boundary locations for the current level"
-						//<< std::endl;
+	if (minIntensity == 0 && maxIntensity == 0) {
 
-				return;
-			}
+		ImageDiscretizer<Precision, ImageType>::findRange(image, minIntensity, maxIntensity);
 
-			//LOG_ALL(imagelevelparserlog)
-					//<< "found location " << newLocation
-					//<< " on the boundary" << std::endl;
+		const ImageType* edges[2] = { &horizontalEdges, &verticalEdges };
+		for (int i = 0; i < 2; i++) {
 
-			// continue searching, if the boundary location was visited already
-			if (_visited(newLocation.x(), newLocation.y())) {
+			typename ImageType::value_type min, max;
+			if (ImageDiscretizer<Precision, ImageType>::findRange(*edges[i], min, max)) {
 
-				//LOG_ALL(imagelevelparserlog) << "this location was visited already" << std::endl;
-				continue;
+				minIntensity = std::min(minIntensity, min);
+				maxIntensity = std::max(maxIntensity, max);
 			}
-
-			//LOG_ALL(imagelevelparserlog) << "going to the new location" << std::endl;
-
-			// we found a not-yet-visited boundary location of the current 
-			// level -- continue filling with it
-			gotoLocation(newLocation, visitor);
-			break;
 		}
 	}
-}
-
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
-bool
-ImageLevelParser<Precision, ImageType>::gotoHigherLevel(VisitorType& visitor) {
 
-	point_type newLocation;
-	Precision  newLevel;
+	_discretizer = ImageDiscretizer<Precision, ImageType>(
+			parameters.darkToBright,
+			minIntensity,
+			maxIntensity);
 
-	//LOG_ALL(imagelevelparserlog)
-			//<< "trying to find smallest boundary location higher then "
-			//<< (int)_currentLevel << std::endl;
+	_stride = std::max(2*width, 1u) - 1 + 2;
 
-	bool found = false;
-
-	// find the lowest boundary location higher then the current level that has 
-	// not been visited yet
-	while (_boundaryLocations.popHigher(_currentLevel, newLocation, newLevel))
-		if (!_visited(newLocation.x(), newLocation.y())) {
-
-			found = true;
-			break;
-		}
-
-	if (!found) {
-
-		//LOG_ALL(imagelevelparserlog) << "nothing found, finishing up" << std::endl;
-
-		// There are no more higher levels, we are done. End all the remaining 
-		// open components (which are at least the component for level 
-		// MaxValue).
-		for (Precision level = _currentLevel;; level++) {
-
-			endComponent(level, visitor);
-
-			if (level == MaxValue)
-				return false;
-		}
-	}
-
-	//LOG_ALL(imagelevelparserlog)
-			//<< "found boundary location " << newLocation
-			//<< " with level " << (int)newLevel << std::endl;
-
-	//LOG_ALL(imagelevelparserlog)
-			//<< "ending all components in the range "
-			//<< (int)_currentLevel << " - " << ((int)newLevel - 1)
-			//<< std::endl;
+	// the pixel list only stores the pixels of the image
+	if (sameShape && _pixelList.unique())
+		_pixelList->clear();
+	else
+		_pixelList = boost::make_shared<PixelList>(image.size(), width);
 
-	gotoLocation(newLocation, visitor);
+	_condensedPixelList.reset();
 
-	assert(_currentLevel == newLevel);
+	padSpacedEdgeImage(image, horizontalEdges, verticalEdges);
 
-	return true;
+	finishReset();
 }
 
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
+template <typename Precision, typename ImageType, int Connectivity>
 bool
-ImageLevelParser<Precision, ImageType>::gotoLowerLevel(Precision referenceLevel, VisitorType& visitor) {
-
-	point_type newLocation;
-	Precision  newLevel;
+ImageLevelParser<Precision, ImageType, Connectivity>::initReset(
+		const ImageType&  image,
+		const Parameters& parameters,
+		bool              spacedEdges) {
 
-	//LOG_ALL(imagelevelparserlog)
-			//<< "trying to find lowest boundary location smaller then "
-			//<< (int)referenceLevel << std::endl;
+	bool sameShape = (_pixelList && image.shape() == _shape && spacedEdges == _spacedEdges);
 
-	// find the lowest boundary location higher then the reference level that 
-	// has not been visited yet
-	while (_boundaryLocations.popLowest(referenceLevel, newLocation, newLevel))
-		if (!_visited(newLocation.x(), newLocation.y())) {
+	_parameters  = parameters;
+	_shape       = image.shape();
+	_spacedEdges = spacedEdges;
 
-			//LOG_ALL(imagelevelparserlog)
-					//<< "found boundary location " << newLocation
-					//<< " with level " << (int)newLevel << std::endl;
+	// levels above the highest rank are empty
+	if (_parameters.rankTransform)
+		_parameters.skipEmptyLevels = true;
 
-			gotoLocation(newLocation, visitor);
-			assert(_currentLevel == newLevel);
-			return true;
-		}
-
-	return false;
+	return sameShape;
 }
 
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-ImageLevelParser<Precision, ImageType>::beginComponent(Precision level, VisitorType& visitor) {
+ImageLevelParser<Precision, ImageType, Connectivity>::finishReset() {
 
-	_componentBegins.push(std::make_pair(level, _pixelList->end()));
-	if (_parameters.spacedEdgeImage)
-		_condensedComponentBegins.push(std::make_pair(level, _condensedPixelList->end()));
+	this->clearFlooding();
 
-	visitor.newChildComponent(getOriginalValue(level));
-}
-
-template <typename Precision, typename ImageType>
-template <typename VisitorType>
-void
-ImageLevelParser<Precision, ImageType>::endComponent(Precision level, VisitorType& visitor) {
-
-	assert(_componentBegins.size() > 0);
-
-	std::pair<Precision, PixelList::iterator> levelBegin;
-	if (_parameters.spacedEdgeImage)
-		levelBegin = _condensedComponentBegins.top();
-	else
-		levelBegin = _componentBegins.top();
-
-	_componentBegins.pop();
-	if (_parameters.spacedEdgeImage)
-		_condensedComponentBegins.pop();
+	_skipEmptyLevels = _parameters.skipEmptyLevels;
 
-	PixelList::iterator begin = levelBegin.second;
-	PixelList::iterator end;
-	if (_parameters.spacedEdgeImage)
-		end = _condensedPixelList->end();
+	if (_skipEmptyLevels)
+		collectLevels();
 	else
-		end = _pixelList->end();
-
-	assert(levelBegin.first == level);
-
-	//LOG_ALL(imagelevelparserlog) << "ending component with level " << (int)level << std::endl;
-
-	visitor.finalizeComponent(
-			getOriginalValue(level),
-			begin, end);
+		_levels.clear();
 }
 
-template <typename Precision, typename ImageType>
-bool
-ImageLevelParser<Precision, ImageType>::findNeighbor(
-		Direction   direction,
-		point_type& neighborLocation,
-		Precision&  neighborLevel) {
-
+template <typename Precision, typename ImageType, int Connectivity>
+void
+ImageLevelParser<Precision, ImageType, Connectivity>::initPaddedImage(unsigned int height) {
 
-	if (direction == Left) {
+	// does not reallocate if the size did not change
+	_paddedLevels.resize(static_cast<size_t>(_stride)*(height + 2));
+	_state.assign(_paddedLevels.size(), Unvisited);
 
-		//LOG_ALL(imagelevelparserlog) << "trying to go left" << std::endl;
+	std::fill(_state.begin(), _state.begin() + _stride, Border);
+	std::fill(_state.end() - _stride, _state.end(), Border);
 
-		if (_currentLocation.x() == 0) {
+	for (unsigned int y = 0; y < height; y++) {
 
-			//LOG_ALL(imagelevelparserlog) << "\tout of bounds" << std::endl;
-			return false;
-		}
+		size_t row = static_cast<size_t>(y + 1)*_stride;
 
-		neighborLocation = _currentLocation + point_type(-1,  0);
+		_state[row]               = Border;
+		_state[row + _stride - 1] = Border;
 	}
-	if (direction == Up) {
 
-		//LOG_ALL(imagelevelparserlog) << "trying to go up" << std::endl;
+	const int stride = _stride;
+	const int offsets[8] = {
+			1, stride, -1, -stride,
+			stride + 1, stride - 1, -stride - 1, -stride + 1 };
 
-		if (_currentLocation.y() == 0) {
-
-			//LOG_ALL(imagelevelparserlog) << "\tout of bounds" << std::endl;
-			return false;
-		}
+	std::copy(offsets, offsets + Connectivity, _neighborOffsets);
+}
 
-		neighborLocation = _currentLocation + point_type( 0, -1);
-	}
-	if (direction == Right) {
+template <typename Precision, typename ImageType, int Connectivity>
+void
+ImageLevelParser<Precision, ImageType, Connectivity>::fillBorder() {
 
-		//LOG_ALL(imagelevelparserlog) << "trying to go right" << std::endl;
-		neighborLocation = _currentLocation + point_type( 1,  0);
-	}
+	const Precision level  = _paddedLevels[_stride + 1];
+	const size_t    height = _paddedLevels.size()/_stride - 2;
 
-	if (direction == Down) {
+	std::fill(_paddedLevels.begin(), _paddedLevels.begin() + _stride, level);
+	std::fill(_paddedLevels.end() - _stride, _paddedLevels.end(), level);
 
-		//LOG_ALL(imagelevelparserlog) << "trying to go down" << std::endl;
-		neighborLocation = _currentLocation + point_type( 0,  1);
-	}
+	for (size_t y = 0; y < height; y++) {
 
-	// out of bounds?
-	if (neighborLocation.x() >= _image.width() ||
-		neighborLocation.y() >= _image.height()) {
+		size_t row = (y + 1)*_stride;
 
-		//LOG_ALL(imagelevelparserlog) << "\tlocation " << neighborLocation << " is out of bounds" << std::endl;
-		return false;
+		_paddedLevels[row]               = level;
+		_paddedLevels[row + _stride - 1] = level;
 	}
+}
 
-	// already visited?
-	if (_visited(neighborLocation.x(), neighborLocation.y())) {
+template <typename Precision, typename ImageType, int Connectivity>
+void
+ImageLevelParser<Precision, ImageType, Connectivity>::padImage() {
 
-		//LOG_ALL(imagelevelparserlog) << "\talready visited" << std::endl;
-		return false;
-	}
+	const unsigned int width  = _image.width();
+	const unsigned int height = _image.height();
 
-	//LOG_ALL(imagelevelparserlog)
-			//<< "succeeded -- valid neighbor is "
-			//<< neighborLocation << std::endl;
+	initPaddedImage(height);
 
-	// we're good
-	neighborLevel = _image(neighborLocation.x(), neighborLocation.y());
+	for (unsigned int y = 0; y < height; y++)
+		std::copy(
+				_image.data() + static_cast<size_t>(y)*width,
+				_image.data() + static_cast<size_t>(y + 1)*width,
+				_paddedLevels.begin() + static_cast<size_t>(y + 1)*_stride + 1);
 
-	return true;
+	fillBorder();
 }
 
-template <typename Precision,
-          typename ImageType>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-ImageLevelParser<Precision, ImageType>::discretizeImageImpl(const ImageType& image, std::false_type) {
+ImageLevelParser<Precision, ImageType, Connectivity>::padSpacedEdgeImage(
+		const ImageType& image,
+		const ImageType& horizontalEdges,
+		const ImageType& verticalEdges) {
 
-	_image.reshape(image.shape());
+	const unsigned int width  = image.width();
+	const unsigned int height = image.height();
 
-	if (_parameters.minIntensity == 0 && _parameters.maxIntensity == 0) {
+	initPaddedImage(std::max(2*height, 1u) - 1);
 
-		image.minmax(&_min, &_max);
+	// the discretized image goes to the even locations...
+	discretizeImage(image);
+	for (unsigned int y = 0; y < height; y++)
+		for (unsigned int x = 0; x < width; x++)
+			_paddedLevels[spacedLocation(x, y)] = _image(x, y);
 
-	} else {
+	// ...the edges between them...
+	if (horizontalEdges.size() > 0) {
 
-		_min = _parameters.minIntensity;
-		_max = _parameters.maxIntensity;
+		discretizeImage(horizontalEdges);
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x + 1 < width; x++)
+				_paddedLevels[spacedLocation(x, y) + 1] = _image(x, y);
 	}
 
-	// in case the whole image has the same intensity
-	if (_max - _min == 0) {
+	if (verticalEdges.size() > 0) {
 
-		_min = 0;
-		_max = 1;
+		discretizeImage(verticalEdges);
+		for (unsigned int y = 0; y + 1 < height; y++)
+			for (unsigned int x = 0; x < width; x++)
+				_paddedLevels[spacedLocation(x, y) + _stride] = _image(x, y);
 	}
 
-	if (_max - _min > std::numeric_limits<Precision>::max())
-		LOG_ERROR(imagelevelparserlog)
-				<< "provided image has a range of " << (_max - _min)
-				<< ", which does not fit into given precision" << std::endl;
-
-	using namespace vigra::functor;
-
-	if (_parameters.darkToBright)
-		vigra::transformImage(
-				srcImageRange(image),
-				destImage(_image),
-				// d = (v-min)/(max-min)*MAX
-				( (Arg1()-Param(_min)) / Param(_max-_min) )*vigra::functor::Param(MaxValue));
-	else // invert the image on-the-fly
-		vigra::transformImage(
-				srcImageRange(image),
-				destImage(_image),
-				// d = MAX - (v-min)/(max-min)*MAX
-				Param(MaxValue) - ( (Arg1()-Param(_min)) / Param(_max-_min) )*Param(MaxValue));
-}
+	// ...and the corners are reached with the last of their edges
+	for (unsigned int y = 0; y + 1 < height; y++)
+		for (unsigned int x = 0; x + 1 < width; x++) {
 
-template <typename Precision,
-          typename ImageType>
-void
-ImageLevelParser<Precision, ImageType>::discretizeImageImpl(const ImageType& image, std::true_type) {
+			size_t corner = spacedLocation(x, y) + _stride + 1;
 
-	_image.reshape(image.shape());
+			_paddedLevels[corner] = std::max(
+					std::max(_paddedLevels[corner - 1], _paddedLevels[corner + 1]),
+					std::max(_paddedLevels[corner - _stride], _paddedLevels[corner + _stride]));
+		}
 
-	LOG_DEBUG(imagelevelparserlog)
-			<< "Requested parser precision and image are same type; "
-			<< "ignoring min and max intensity parameters and using "
-			<< "full precision range" << std::endl;
-
-	_min = std::numeric_limits<Precision>::max();
-	_max = std::numeric_limits<Precision>::max();
-
-	using namespace vigra::functor;
-
-	if (_parameters.darkToBright)
-		vigra::copyImage(
-				srcImageRange(image),
-				destImage(_image));
-	else // invert the image on-the-fly
-		vigra::transformImage(
-				srcImageRange(image),
-				destImage(_image),
-				(Param(_max) - Arg1()) + Param(_min));
+	fillBorder();
 }
 
-template <typename Precision,
-          typename ImageType>
-typename ImageType::value_type
-ImageLevelParser<Precision, ImageType>::getOriginalValueImpl(Precision value, std::false_type) {
-
-	if (_parameters.darkToBright)
-		// v = (d/MAX)*(max-min)+min
-		return (static_cast<typename ImageType::value_type>(value)/MaxValue)*(_max - _min) + _min;
-	else
-		// v = ((MAX-d)/MAX)*(max-min)+min
-		return (static_cast<typename ImageType::value_type>(MaxValue - value)/MaxValue)*(_max - _min) + _min;
-}
+template <typename Precision, typename ImageType, int Connectivity>
+template <typename VisitorType>
+void
+ImageLevelParser<Precision, ImageType, Connectivity>::parse(VisitorType& visitor) {
 
-template <typename Precision,
-          typename ImageType>
-typename ImageType::value_type
-ImageLevelParser<Precision, ImageType>::getOriginalValueImpl(Precision value, std::true_type) {
+	LOG_ALL(imagelevelparserlog) << "parsing image" << std::endl;
 
-	if (_parameters.darkToBright)
-		return value;
+	if (_parameters.spacedEdgeImage)
+		visitor.setPixelList(_condensedPixelList);
 	else
-		return (std::numeric_limits<Precision>::max() - value) + std::numeric_limits<Precision>::min();
-}
-
+		visitor.setPixelList(_pixelList);
 
+	// start at the first pixel of the image
+	this->flood(_stride + 1, visitor);
+}
 
-// SparseBoundaryLocations map implementation
-template <typename Precision>
+template <typename Precision, typename ImageType, int Connectivity>
 void
-image_level_parser_detail::SparseBoundaryLocations<Precision>::push(
-		const point_type& location,
-		const Precision   level) {
+ImageLevelParser<Precision, ImageType, Connectivity>::addLocation(location_type location) {
 
-	_boundaryLocations[level].push(location);
-}
+	// the index of the location in an image of width _stride without border
+	unsigned int index = location - _stride - 1;
 
-template <typename Precision>
-bool
-image_level_parser_detail::SparseBoundaryLocations<Precision>::pop(
-		const Precision level,
-		point_type&     boundaryLocation) {
+	if (_spacedEdges) {
 
-	typename boundary_locations_type::iterator it = _boundaryLocations.find(level);
-	if (it == _boundaryLocations.end())
-		return false;
+		// only the pixels of the image are reported, edges and corners are 
+		// needed for the connectivity only
+		unsigned int x = index % _stride;
+		unsigned int y = index / _stride;
 
-	return pop(*it, boundaryLocation);
-}
+		if (x % 2 == 0 && y % 2 == 0) {
 
-template <typename Precision>
-bool
-image_level_parser_detail::SparseBoundaryLocations<Precision>::pop(
-		typename boundary_locations_type::value_type& val,
-		point_type& boundaryLocation) {
+			_pixelList->addIndex((y/2)*_pixelList->getWidth() + x/2);
 
-	typename boundary_locations_type::mapped_type& locations = val.second;
-	if (locations.empty())
-		return false;
+			if (_accumulateAttributes)
+				_attributes.back().add(x/2, y/2, _paddedLevels[location]);
+		}
 
-	boundaryLocation = locations.top();
-	locations.pop();
+		return;
+	}
 
-	return true;
-}
+	if (_parameters.spacedEdgeImage) {
 
-template <typename Precision>
-bool
-image_level_parser_detail::SparseBoundaryLocations<Precision>::popLowest(
-		const Precision level,
-		point_type&     boundaryLocation,
-		Precision&      boundaryLevel) {
+		unsigned int x = index % _stride;
+		unsigned int y = index / _stride;
 
-	for (typename boundary_locations_type::iterator it = _boundaryLocations.begin(); (*it).first < level; ++it) {
+		if (x % 2 == 0 && y % 2 == 0) {
 
-		if (pop(*it, boundaryLocation)) {
+			_condensedPixelList->add(util::point<unsigned int,2>(x/2, y/2));
 
-			boundaryLevel = it->first;
-			return true;
+			if (_accumulateAttributes)
+				_attributes.back().add(x/2, y/2, _paddedLevels[location]);
 		}
-	}
-
-	return false;
-}
-
-template <typename Precision>
-bool
-image_level_parser_detail::SparseBoundaryLocations<Precision>::popHigher(
-		const Precision level,
-		point_type&     boundaryLocation,
-		Precision&      boundaryLevel) {
-
-	for (typename boundary_locations_type::iterator it = _boundaryLocations.upper_bound(level); it != _boundaryLocations.end(); ++it) {
 
-		if (pop(*it, boundaryLocation)) {
+	} else if (_accumulateAttributes) {
 
-			boundaryLevel = it->first;
-			return true;
-		}
+		_attributes.back().add(index % _stride, index / _stride, _paddedLevels[location]);
 	}
 
-	return false;
+	_pixelList->addIndex(index);
 }
 
-
-
-// DenseBoundaryLocations vector implementation
-template <typename Precision>
+template <typename Precision,
+          typename ImageType,
+          int Connectivity>
 void
-image_level_parser_detail::DenseBoundaryLocations<Precision>::push(
-		const point_type& location,
-		const Precision   level) {
-
-	_boundaryLocations[level].push(location);
-}
-
-template <typename Precision>
-bool
-image_level_parser_detail::DenseBoundaryLocations<Precision>::pop(
-		const Precision level,
-		point_type&     boundaryLocation) {
-
-	typename boundary_locations_type::value_type& locations = _boundaryLocations[level];
+ImageLevelParser<Precision, ImageType, Connectivity>::collectLevelsImpl(std::true_type) {
 
-	if (locations.empty())
-		return false;
+	// few possible levels, mark the ones we see
+	std::vector<bool> present(static_cast<size_t>(MaxValue) + 1, false);
 
-	boundaryLocation = locations.top();
-	locations.pop();
+	// the border has the level of the first pixel and can be included
+	for (typename std::vector<Precision>::const_iterator i = _paddedLevels.begin(); i != _paddedLevels.end(); i++)
+		present[*i] = true;
 
-	return true;
-}
-
-template <typename Precision>
-bool
-image_level_parser_detail::DenseBoundaryLocations<Precision>::popLowest(
-		const Precision level,
-		point_type&     boundaryLocation,
-		Precision&      boundaryLevel) {
-
-	for (Precision l = 0; l < level; l++) {
-
-		if (pop(l, boundaryLocation)) {
+	_levels.clear();
+	for (size_t level = 0; level < present.size(); level++)
+		if (present[level])
+			_levels.push_back(level);
 
-			boundaryLevel = l;
-			return true;
-		}
-	}
-
-	return false;
+	LOG_DEBUG(imagelevelparserlog)
+			<< "image contains " << _levels.size() << " distinct levels" << std::endl;
 }
 
-template <typename Precision>
-bool
-image_level_parser_detail::DenseBoundaryLocations<Precision>::popHigher(
-		const Precision level,
-		point_type&     boundaryLocation,
-		Precision&      boundaryLevel) {
-
-	if (level == MAX_LEVEL)
-		return false;
-
-	for (Precision l = level + 1;; l++) {
-
-		if (pop(l, boundaryLocation)) {
+template <typename Precision,
+          typename ImageType,
+          int Connectivity>
+void
+ImageLevelParser<Precision, ImageType, Connectivity>::collectLevelsImpl(std::false_type) {
 
-			boundaryLevel = l;
-			return true;
-		}
+	// too many possible levels to mark them, sort the ones we have instead
+	_levels.assign(_paddedLevels.begin(), _paddedLevels.end());
+	std::sort(_levels.begin(), _levels.end());
+	_levels.erase(std::unique(_levels.begin(), _levels.end()), _levels.end());
 
-		if (l == MAX_LEVEL)
-			return false;
-	}
+	LOG_DEBUG(imagelevelparserlog)
+			<< "image contains " << _levels.size() << " distinct levels" << std::endl;
 }
 
 #endif // IMAGEPROCESSING_IMAGE_LEVEL_PARSER_H__
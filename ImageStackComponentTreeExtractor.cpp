@@ -0,0 +1,7 @@
+#include "ImageStackComponentTreeExtractor.h"
+
+// explicit template instantiations
+template class ImageStackComponentTreeExtractor<unsigned char>;
+template class ImageStackComponentTreeExtractor<unsigned short>;
+
+logger::LogChannel imagestackcomponenttreeextractorlog("imagestackcomponenttreeextractorlog", "[ImageStackComponentTreeExtractor] ");
@@ -0,0 +1,267 @@
+#ifndef IMAGEPROCESSING_IMAGE_STACK_COMPONENT_TREE_EXTRACTOR_H__
+#define IMAGEPROCESSING_IMAGE_STACK_COMPONENT_TREE_EXTRACTOR_H__
+
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
+#include <pipeline/SimpleProcessNode.h>
+#include <pipeline/Value.h>
+#include <util/Logger.h>
+#include "ComponentTreeExtractor.h"
+#include "ComponentTreeExtractorParameters.h"
+#include "ComponentTrees.h"
+#include "ImageStack.h"
+
+extern logger::LogChannel imagestackcomponenttreeextractorlog;
+
+/**
+ * Extracts the component tree of each section of an image stack with a
+ * ComponentTreeExtractor. The sections are extracted in parallel by a pool of
+ * threads, which take the next unprocessed section whenever they are done
+ * with one. The number of threads and the estimated memory used by sections
+ * that are extracted at the same time are limited by the parameters (see
+ * ComponentTreeExtractorParameters::numSectionThreads and memoryBudget).
+ *
+ * The resulting trees are stored with the index of their section and do not
+ * depend on the order in which the sections were processed.
+ */
+template <typename Precision = unsigned char, typename ImageType = IntensityImage>
+class ImageStackComponentTreeExtractor : public pipeline::SimpleProcessNode<> {
+
+public:
+
+	ImageStackComponentTreeExtractor();
+
+	/**
+	 * Estimate the number of bytes needed to extract the component tree of
+	 * the given section, including the resulting pixel list and tree.
+	 */
+	static size_t estimateMemory(const ImageType& section);
+
+private:
+
+	void updateOutputs();
+
+	/**
+	 * Extract the component trees of the remaining sections, until there are
+	 * none left. Invoked by each thread of the pool.
+	 */
+	void extractSections();
+
+	/**
+	 * Extract the component tree of the given section.
+	 */
+	boost::shared_ptr<ComponentTree> extractSection(unsigned int section);
+
+	/**
+	 * Wait until the memory for extracting the given section fits into the
+	 * budget, and reserve it. Sections are always admitted if no other
+	 * section is being extracted.
+	 */
+	void acquireMemory(size_t bytes);
+
+	/**
+	 * Release the memory reserved by acquireMemory().
+	 */
+	void releaseMemory(size_t bytes);
+
+	pipeline::Input<ImageStack<ImageType> >                                            _stack;
+	pipeline::Input<ComponentTreeExtractorParameters<typename ImageType::value_type> > _parameters;
+	pipeline::Output<ComponentTrees>                                                   _componentTrees;
+
+	// the trees of the sections, in the order of the sections
+	std::vector<boost::shared_ptr<ComponentTree> > _trees;
+
+	// the next section to extract
+	unsigned int _nextSection;
+
+	// the memory budget and the memory currently reserved
+	size_t _memoryBudget;
+	size_t _memoryUsed;
+
+	// the first exception thrown by one of the threads
+	boost::exception_ptr _exception;
+
+	boost::mutex              _mutex;
+	boost::condition_variable _memoryReleased;
+};
+
+////////////////////
+// IMPLEMENTATION //
+////////////////////
+
+template <typename Precision, typename ImageType>
+ImageStackComponentTreeExtractor<Precision, ImageType>::ImageStackComponentTreeExtractor() {
+
+	registerInput(_stack, "image stack");
+	registerInput(_parameters, "parameters", pipeline::Optional);
+	registerOutput(_componentTrees, "component trees");
+}
+
+template <typename Precision, typename ImageType>
+size_t
+ImageStackComponentTreeExtractor<Precision, ImageType>::estimateMemory(const ImageType& section) {
+
+	// per pixel: the discretized image and the parse state, the pixel list,
+	// and about as many nodes and parser stack entries as pixels in the
+	// worst case
+	const size_t bytesPerPixel = sizeof(Precision) + 1 + sizeof(unsigned int) + 2*sizeof(unsigned int);
+
+	return static_cast<size_t>(section.width())*section.height()*bytesPerPixel;
+}
+
+template <typename Precision, typename ImageType>
+void
+ImageStackComponentTreeExtractor<Precision, ImageType>::updateOutputs() {
+
+	if (!_componentTrees)
+		_componentTrees = new ComponentTrees();
+	else
+		_componentTrees->clear();
+
+	const unsigned int numSections = _stack->size();
+
+	unsigned int numThreads = 1;
+	_memoryBudget = 0;
+
+	if (_parameters.isSet()) {
+
+		numThreads    = _parameters->numSectionThreads;
+		_memoryBudget = _parameters->memoryBudget;
+	}
+
+	if (numThreads == 0)
+		numThreads = std::max(1u, boost::thread::hardware_concurrency());
+	numThreads = std::max(1u, std::min(numThreads, numSections));
+
+	LOG_DEBUG(imagestackcomponenttreeextractorlog)
+			<< "extracting component trees of " << numSections
+			<< " sections with " << numThreads << " threads" << std::endl;
+
+	_trees.assign(numSections, boost::shared_ptr<ComponentTree>());
+	_nextSection = 0;
+	_memoryUsed  = 0;
+	_exception   = boost::exception_ptr();
+
+	if (numThreads == 1) {
+
+		extractSections();
+
+	} else {
+
+		boost::thread_group workers;
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			workers.add_thread(
+					new boost::thread(
+							&ImageStackComponentTreeExtractor::extractSections,
+							this));
+
+		workers.join_all();
+	}
+
+	if (_exception)
+		boost::rethrow_exception(_exception);
+
+	for (unsigned int section = 0; section < numSections; section++)
+		_componentTrees->setTree(section, _trees[section]);
+
+	_trees.clear();
+}
+
+template <typename Precision, typename ImageType>
+void
+ImageStackComponentTreeExtractor<Precision, ImageType>::extractSections() {
+
+	while (true) {
+
+		unsigned int section;
+
+		{
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (_nextSection == _trees.size() || _exception)
+				return;
+
+			section = _nextSection;
+			_nextSection++;
+		}
+
+		const size_t bytes = estimateMemory(*(*_stack)[section]);
+
+		acquireMemory(bytes);
+
+		try {
+
+			_trees[section] = extractSection(section);
+
+		} catch (...) {
+
+			boost::mutex::scoped_lock lock(_mutex);
+
+			if (!_exception)
+				_exception = boost::current_exception();
+		}
+
+		releaseMemory(bytes);
+	}
+}
+
+template <typename Precision, typename ImageType>
+boost::shared_ptr<ComponentTree>
+ImageStackComponentTreeExtractor<Precision, ImageType>::extractSection(unsigned int section) {
+
+	LOG_ALL(imagestackcomponenttreeextractorlog)
+			<< "extracting component tree of section " << section << std::endl;
+
+	// each section gets its own extractor and copy of the parameters, such
+	// that threads don't share any pipeline data
+	ComponentTreeExtractor<Precision, ImageType> extractor;
+
+	extractor.setInput("image", (*_stack)[section]);
+
+	if (_parameters.isSet()) {
+
+		pipeline::Value<ComponentTreeExtractorParameters<typename ImageType::value_type> > parameters(*_parameters);
+		extractor.setInput("parameters", parameters);
+	}
+
+	pipeline::Value<ComponentTree> tree;
+	tree = extractor.getOutput("component tree");
+
+	return tree.getSharedPointer();
+}
+
+template <typename Precision, typename ImageType>
+void
+ImageStackComponentTreeExtractor<Precision, ImageType>::acquireMemory(size_t bytes) {
+
+	if (_memoryBudget == 0)
+		return;
+
+	boost::mutex::scoped_lock lock(_mutex);
+
+	while (_memoryUsed > 0 && _memoryUsed + bytes > _memoryBudget)
+		_memoryReleased.wait(lock);
+
+	_memoryUsed += bytes;
+}
+
+template <typename Precision, typename ImageType>
+void
+ImageStackComponentTreeExtractor<Precision, ImageType>::releaseMemory(size_t bytes) {
+
+	if (_memoryBudget == 0)
+		return;
+
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_memoryUsed -= bytes;
+	}
+
+	_memoryReleased.notify_all();
+}
+
+#endif // IMAGEPROCESSING_IMAGE_STACK_COMPONENT_TREE_EXTRACTOR_H__
+
@@ -1,57 +1,273 @@
 #ifndef IMAGEPROCESSING_PIXEL_LIST_H__
 #define IMAGEPROCESSING_PIXEL_LIST_H__
 
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
 #include <util/point.hpp>
 
+#include "exceptions.h"
+
 /**
- * A list of pixel locations. As long as the initially set size is not exceeded, 
+ * A list of pixel locations. As long as the initially set size is not exceeded,
  * adding pixels and clearing does not invalidate iterators into the list.
+ *
+ * Pixel lists can be created in a compact mode by giving the width of the
+ * image the pixels belong to. In this mode, each pixel is stored as a single
+ * 32-bit linear index y*width + x (instead of two coordinates), which halves
+ * the memory needed. Iterators decode the pixel locations on access, and thus
+ * dereference to values instead of references. The width only has to be 
+ * larger than all x coordinates, i.e., it can also be the row stride of a 
+ * padded image.
+ *
+ * Note that this changes the iterator interface for all pixel lists, compact
+ * or not: PixelList::iterator is the same type as PixelList::const_iterator.
+ * Dereferencing it returns a pixel location by value, so pixels can not be
+ * modified through iterators and no references or pointers into the list can
+ * be taken. Code that wrote through iterators has to create a new pixel list
+ * instead.
+ *
+ * Pixel lists can also refer to external memory, e.g., a memory mapped
+ * file. Such pixel lists can not be modified, and adding pixels or clearing
+ * them throws an InvalidOperation.
  */
 class PixelList {
 
-	typedef std::vector<util::point<unsigned int,2> > pixel_list_type;
+	typedef std::vector<unsigned int> pixel_list_type;
 
 public:
 
-	typedef pixel_list_type::iterator       iterator;
-	typedef pixel_list_type::const_iterator const_iterator;
+	typedef util::point<unsigned int,2> value_type;
+
+	class const_iterator {
+
+	public:
+
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef PixelList::value_type           value_type;
+		typedef std::ptrdiff_t                  difference_type;
+		typedef value_type                      reference;
+
+		/**
+		 * Helper to support operator-> on decoded pixel locations.
+		 */
+		class pointer {
+
+		public:
+
+			pointer(const value_type& pixel) : _pixel(pixel) {}
+
+			const value_type* operator->() const { return &_pixel; }
+
+		private:
+
+			value_type _pixel;
+		};
+
+		const_iterator() : _pos(0), _width(0) {}
+
+		const_iterator(const unsigned int* pos, unsigned int width) :
+			_pos(pos),
+			_width(width) {}
+
+		value_type operator*() const {
+
+			if (_width)
+				return value_type(*_pos % _width, *_pos / _width);
+
+			return value_type(_pos[0], _pos[1]);
+		}
+
+		pointer    operator->() const { return pointer(**this); }
+		value_type operator[](difference_type n) const { return *(*this + n); }
+
+		const_iterator& operator++() { _pos += stride(); return *this; }
+		const_iterator& operator--() { _pos -= stride(); return *this; }
+		const_iterator  operator++(int) { const_iterator i = *this; ++(*this); return i; }
+		const_iterator  operator--(int) { const_iterator i = *this; --(*this); return i; }
 
-	PixelList() {}
+		const_iterator& operator+=(difference_type n) { _pos += n*stride(); return *this; }
+		const_iterator& operator-=(difference_type n) { _pos -= n*stride(); return *this; }
+		const_iterator  operator+(difference_type n) const { const_iterator i = *this; return i += n; }
+		const_iterator  operator-(difference_type n) const { const_iterator i = *this; return i -= n; }
+
+		difference_type operator-(const const_iterator& other) const { return (_pos - other._pos)/stride(); }
+
+		bool operator==(const const_iterator& other) const { return _pos == other._pos; }
+		bool operator!=(const const_iterator& other) const { return _pos != other._pos; }
+		bool operator< (const const_iterator& other) const { return _pos <  other._pos; }
+		bool operator> (const const_iterator& other) const { return _pos >  other._pos; }
+		bool operator<=(const const_iterator& other) const { return _pos <= other._pos; }
+		bool operator>=(const const_iterator& other) const { return _pos >= other._pos; }
+
+		/**
+		 * Direct access to the underlying storage. In compact mode, this points
+		 * to the linear index of the current pixel, otherwise to its x and y
+		 * coordinate.
+		 */
+		const unsigned int* data() const { return _pos; }
+
+		/**
+		 * The width used to decode linear indices, or 0 if the pixel list
+		 * this iterator belongs to is not compact.
+		 */
+		unsigned int width() const { return _width; }
+
+	private:
+
+		difference_type stride() const { return (_width ? 1 : 2); }
+
+		const unsigned int* _pos;
+		unsigned int        _width;
+	};
+
+	// pixel lists can not be modified through iterators, not even if they are
+	// not compact (see class documentation)
+	typedef const_iterator iterator;
+
+	PixelList() : _width(0), _data(0), _dataSize(0) {}
 
 	/**
 	 * Create a new pixel list of the given size.
 	 */
-	PixelList(size_t size) {
+	PixelList(size_t size) :
+		_width(0),
+		_data(0),
+		_dataSize(0) {
+
+		_pixelList.reserve(2*size);
+	}
+
+	/**
+	 * Create a new compact pixel list of the given size for pixels of an image
+	 * with the given width.
+	 */
+	PixelList(size_t size, unsigned int width) :
+		_width(width),
+		_data(0),
+		_dataSize(0) {
 
 		_pixelList.reserve(size);
 	}
 
 	/**
-	 * Add a pixel to the pixel list. Existing iterators are not invalidated, as 
+	 * Create a compact pixel list from the given linear indices of pixels of 
+	 * an image with the given width. The indices are moved into the pixel 
+	 * list without copying, which leaves the given vector empty.
+	 */
+	PixelList(std::vector<unsigned int>& indices, unsigned int width) :
+		_width(width),
+		_data(0),
+		_dataSize(0) {
+
+		_pixelList.swap(indices);
+	}
+
+	/**
+	 * Create a pixel list that refers to the given pixels in external memory,
+	 * which is kept alive by 'storage' as long as the pixel list exists.
+	 * 'size' is the number of unsigned ints, and 'width' the width for compact
+	 * pixel lists or 0.
+	 */
+	PixelList(
+			const unsigned int*           pixels,
+			size_t                        size,
+			unsigned int                  width,
+			boost::shared_ptr<const void> storage) :
+		_width(width),
+		_data(pixels),
+		_dataSize(size),
+		_storage(storage) {}
+
+	/**
+	 * Add a pixel to the pixel list. Existing iterators are not invalidated, as
 	 * long as 'size' is not exceeded.
 	 */
 	void add(const util::point<unsigned int,2>& pixel) {
 
-		_pixelList.push_back(pixel);
+		if (_data)
+			throwReadOnly();
+
+		if (_width) {
+
+			_pixelList.push_back(pixel.y()*_width + pixel.x());
+
+		} else {
+
+			_pixelList.push_back(pixel.x());
+			_pixelList.push_back(pixel.y());
+		}
+	}
+
+	/**
+	 * Add a pixel given by its linear index y*width + x. Only valid for 
+	 * compact pixel lists.
+	 */
+	void addIndex(unsigned int index) {
+
+		if (_data)
+			throwReadOnly();
+
+		_pixelList.push_back(index);
+	}
+
+	/**
+	 * Remove all pixels from the pixel list, keeping its allocated size.
+	 */
+	void clear() {
+
+		if (_data)
+			throwReadOnly();
+
+		_pixelList.clear();
 	}
 
 	/**
 	 * Iterator access.
 	 */
-	iterator       begin() { return _pixelList.begin(); }
-	const_iterator begin() const { return _pixelList.begin(); }
-	iterator       end() { return _pixelList.end(); }
-	const_iterator end() const { return _pixelList.end(); }
+	const_iterator begin() const { return const_iterator(data(), _width); }
+	const_iterator end() const { return const_iterator(data() + dataSize(), _width); }
 
 	/**
 	 * The number of pixels that have been added to this pixel list.
 	 */
-	size_t size() const { return _pixelList.size(); }
+	size_t size() const { return (_width ? dataSize() : dataSize()/2); }
+
+	/**
+	 * True, if this pixel list stores linear indices.
+	 */
+	bool isCompact() const { return _width != 0; }
+
+	/**
+	 * The width of the image the linear indices of a compact pixel list refer
+	 * to.
+	 */
+	unsigned int getWidth() const { return _width; }
 
 private:
 
-	// a non-resizing vector of pixel locations
+	static void throwReadOnly() {
+
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"pixel lists in external memory can not be modified");
+	}
+
+	const unsigned int* data() const { return (_data ? _data : _pixelList.data()); }
+
+	size_t dataSize() const { return (_data ? _dataSize : _pixelList.size()); }
+
+	// a non-resizing vector of linear indices or pairs of coordinates
 	pixel_list_type _pixelList;
+
+	// the width of the image for compact pixel lists, 0 otherwise
+	unsigned int _width;
+
+	// external memory holding the pixels instead of _pixelList, if set
+	const unsigned int*           _data;
+	size_t                        _dataSize;
+	boost::shared_ptr<const void> _storage;
 };
 
 #endif // IMAGEPROCESSING_PIXEL_LIST_H__
@@ -0,0 +1,3 @@
+#include "SameIntensityParser.h"
+
+logger::LogChannel sameintensityparserlog("sameintensityparserlog", "[SameIntensityParser] ");
@@ -0,0 +1,271 @@
+#ifndef IMAGEPROCESSING_SAME_INTENSITY_PARSER_H__
+#define IMAGEPROCESSING_SAME_INTENSITY_PARSER_H__
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include <util/Logger.h>
+#include "PixelList.h"
+#include "Image.h"
+#include "ImageLevelParser.h"
+#include "ComponentAttributes.h"
+#include "VisitorCallbacks.h"
+
+extern logger::LogChannel sameintensityparserlog;
+
+/**
+ * Extracts the flat component tree of an image with integral values, e.g., a
+ * label image: The children of the root (the whole image) are the 4-connected
+ * regions of pixels with the same non-zero value. Pixels with value 0 are
+ * background and only part of the root.
+ *
+ * The regions are found in a single union-find labelling pass over the image,
+ * and the pixels are grouped per region into one compact pixel list. The
+ * values of the image are neither copied nor discretized, such that the
+ * visitor receives the exact values (labels) of the regions.
+ *
+ * Visitors are the same as for ImageLevelParser. The levels passed to level
+ * visitors are the values of the regions.
+ */
+template <typename ImageType = LabelImage>
+class SameIntensityParser {
+
+public:
+
+	typedef typename ImageType::value_type value_type;
+
+	// the visitor interface does not depend on the precision of the level
+	// parser
+	typedef typename ImageLevelParser<unsigned char, ImageType>::Visitor Visitor;
+
+	/**
+	 * Create a new same intensity parser for the given image.
+	 */
+	SameIntensityParser(const ImageType& image);
+
+	/**
+	 * Parse the image. The provided visitor has to implement the interface of
+	 * ImageLevelParser::Visitor (but does not need to inherit from it). The
+	 * visitor is called for the root, and for each region as a child of the
+	 * root, in the order of the first pixel of each region.
+	 */
+	template <typename VisitorType>
+	void parse(VisitorType& visitor);
+
+	/**
+	 * The levels of this parser are the values of the image.
+	 */
+	value_type getOriginalValue(value_type level) const {
+		return level;
+	}
+
+private:
+
+	/**
+	 * Find the root of the union-find set of the given pixel, with path
+	 * halving.
+	 */
+	inline unsigned int findRoot(unsigned int pixel) {
+
+		while (_parents[pixel] != pixel) {
+
+			_parents[pixel] = _parents[_parents[pixel]];
+			pixel = _parents[pixel];
+		}
+
+		return pixel;
+	}
+
+	/**
+	 * Merge the sets of the given pixels. The smaller root becomes the root of
+	 * the merged set, such that each pixel has a parent that precedes it.
+	 */
+	inline void merge(unsigned int a, unsigned int b) {
+
+		a = findRoot(a);
+		b = findRoot(b);
+
+		if (a < b)
+			_parents[b] = a;
+		else if (b < a)
+			_parents[a] = b;
+	}
+
+	/**
+	 * Label the regions of the image and group their pixels in the pixel list.
+	 */
+	void labelRegions();
+
+	const ImageType& _image;
+
+	unsigned int _width;
+	unsigned int _height;
+
+	// the union-find parents of the pixels, replaced by the region of each
+	// pixel after labelling
+	std::vector<unsigned int> _parents;
+
+	// the pixel list, grouped by regions, followed by the background pixels
+	boost::shared_ptr<PixelList> _pixelList;
+
+	// the begin of each region in the pixel list, and the begin of the
+	// background pixels
+	std::vector<unsigned int> _regionBegins;
+
+	// the value of each region
+	std::vector<value_type> _regionValues;
+};
+
+////////////////////
+// IMPLEMENTATION //
+////////////////////
+
+template <typename ImageType>
+SameIntensityParser<ImageType>::SameIntensityParser(const ImageType& image) :
+	_image(image),
+	_width(image.width()),
+	_height(image.height()) {}
+
+template <typename ImageType>
+template <typename VisitorType>
+void
+SameIntensityParser<ImageType>::parse(VisitorType& visitor) {
+
+	typedef VisitorCallbacks<VisitorType, Visitor, value_type, value_type> callbacks;
+
+	labelRegions();
+
+	visitor.setPixelList(_pixelList);
+
+	if (_image.size() == 0)
+		return;
+
+	const unsigned int numRegions = _regionValues.size();
+
+	callbacks::newChild(visitor, 0, *this);
+
+	ComponentAttributes rootAttributes;
+
+	for (unsigned int region = 0; region < numRegions; region++) {
+
+		const value_type value = _regionValues[region];
+
+		PixelList::const_iterator begin = _pixelList->begin() + _regionBegins[region];
+		PixelList::const_iterator end   = _pixelList->begin() + _regionBegins[region + 1];
+
+		ComponentAttributes attributes;
+		if (callbacks::AcceptsAttributes) {
+
+			for (PixelList::const_iterator i = begin; i != end; i++)
+				attributes.add(i->x(), i->y(), value);
+			rootAttributes.merge(attributes);
+		}
+
+		callbacks::newChild(visitor, value, *this);
+		callbacks::finalize(visitor, value, *this, begin, end, attributes);
+	}
+
+	// the background pixels belong to the root only
+	if (callbacks::AcceptsAttributes)
+		for (PixelList::const_iterator i = _pixelList->begin() + _regionBegins[numRegions]; i != _pixelList->end(); i++)
+			rootAttributes.add(i->x(), i->y(), 0);
+
+	callbacks::finalize(visitor, 0, *this, _pixelList->begin(), _pixelList->end(), rootAttributes);
+}
+
+template <typename ImageType>
+void
+SameIntensityParser<ImageType>::labelRegions() {
+
+	const unsigned int size = _width*_height;
+
+	_parents.resize(size);
+	for (unsigned int i = 0; i < size; i++)
+		_parents[i] = i;
+
+	// merge each pixel with its left and upper neighbor of the same value
+
+	for (unsigned int y = 0; y < _height; y++)
+		for (unsigned int x = 0; x < _width; x++) {
+
+			const value_type value = _image(x, y);
+
+			if (value == 0)
+				continue;
+
+			const unsigned int i = y*_width + x;
+
+			if (x > 0 && _image(x - 1, y) == value)
+				merge(i, i - 1);
+			if (y > 0 && _image(x, y - 1) == value)
+				merge(i, i - _width);
+		}
+
+	// Replace the parent of each pixel by its region. Since parents precede
+	// their children, the parent of a pixel that is not a root already
+	// contains the region of the set.
+
+	_regionValues.clear();
+	_regionBegins.assign(1, 0);
+
+	unsigned int numBackground = 0;
+
+	for (unsigned int y = 0, i = 0; y < _height; y++)
+		for (unsigned int x = 0; x < _width; x++, i++) {
+
+			const value_type value = _image(x, y);
+
+			if (value == 0) {
+
+				numBackground++;
+				continue;
+			}
+
+			const unsigned int parent = _parents[i];
+
+			if (parent == i) {
+
+				_parents[i] = _regionValues.size();
+				_regionValues.push_back(value);
+				_regionBegins.push_back(0);
+
+			} else {
+
+				_parents[i] = _parents[parent];
+			}
+
+			// count the pixels of each region
+			_regionBegins[_parents[i] + 1]++;
+		}
+
+	const unsigned int numRegions = _regionValues.size();
+
+	for (unsigned int region = 0; region < numRegions; region++)
+		_regionBegins[region + 1] += _regionBegins[region];
+
+	LOG_ALL(sameintensityparserlog)
+			<< "found " << numRegions << " regions and "
+			<< numBackground << " background pixels" << std::endl;
+
+	// sort the pixels into their regions, background pixels last
+
+	std::vector<unsigned int> pixels(size);
+	std::vector<unsigned int> next(_regionBegins.begin(), _regionBegins.end());
+
+	for (unsigned int y = 0, i = 0; y < _height; y++)
+		for (unsigned int x = 0; x < _width; x++, i++) {
+
+			if (_image(x, y) == 0)
+				pixels[next[numRegions]++] = i;
+			else
+				pixels[next[_parents[i]]++] = i;
+		}
+
+	// the union-find parents are not needed anymore
+	std::vector<unsigned int>().swap(_parents);
+
+	_pixelList = boost::make_shared<PixelList>(pixels, _width);
+}
+
+#endif // IMAGEPROCESSING_SAME_INTENSITY_PARSER_H__
@@ -0,0 +1,3 @@
+#include "StreamingLevelParser.h"
+
+logger::LogChannel streaminglevelparserlog("streaminglevelparserlog", "[StreamingLevelParser] ");
@@ -0,0 +1,1018 @@
+#ifndef IMAGEPROCESSING_STREAMING_LEVEL_PARSER_H__
+#define IMAGEPROCESSING_STREAMING_LEVEL_PARSER_H__
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/filesystem.hpp>
+
+#include <util/Logger.h>
+#include "PixelList.h"
+#include "Image.h"
+#include "ImageDiscretizer.h"
+#include "ImageLevelParser.h"
+#include "ComponentAttributes.h"
+#include "VisitorCallbacks.h"
+#include "exceptions.h"
+
+extern logger::LogChannel streaminglevelparserlog;
+
+/**
+ * A parser for images that are too large to be held in memory together with
+ * the buffers of ImageLevelParser or UnionFindParser. The image is passed in
+ * strips of consecutive rows, from top to bottom, and only one strip is held
+ * at a time.
+ *
+ * The pixel tree of each strip is built with the union-find algorithm of
+ * UnionFindParser, and merged with the components of the previous strips
+ * along the last row of the previous strip (the frontier). Only the
+ * components that contain a pixel of the frontier (and their ancestors) can
+ * still change. All other components are final and are written to a
+ * temporary file, together with the component of each pixel. Therefore, the
+ * memory needed while adding strips depends on the strip size and the number
+ * of open components only.
+ *
+ * When all rows have been added, the component tree is assembled from the
+ * temporary files and passed to the visitor. This step is not bounded by the
+ * strip size: All nodes are read back into memory (about 20 bytes each, plus
+ * 16 bytes for the children of each node), and the pixel list that is passed 
+ * to the visitor holds 4 bytes per pixel. Since there can be as many nodes 
+ * as pixels, the peak memory of parse() is up to about 40 bytes per pixel of 
+ * the image. The components, their order,
+ * and the order of their pixels are the same as for UnionFindParser on the
+ * whole image. Compared to ImageLevelParser, the components are the same, but
+ * their order is not (see UnionFindParser).
+ *
+ * Parameters and visitors are the same as for ImageLevelParser, except that
+ * rank transform and quantiles are not supported, since they need the
+ * intensities of the whole image. For the same reason, the intensity range
+ * (minIntensity, maxIntensity) should be set, otherwise each strip is
+ * discretized with its own range.
+ */
+template <typename Precision = unsigned char, typename ImageType = IntensityImage>
+class StreamingLevelParser {
+
+public:
+
+	typedef typename ImageLevelParser<Precision, ImageType>::Visitor Visitor;
+
+	/**
+	 * Parameters of the streaming level parser. Same as for
+	 * ImageLevelParser, with the addition of the directory for the temporary
+	 * files.
+	 */
+	struct Parameters : public ImageLevelParser<Precision, ImageType>::Parameters {
+
+		Parameters() {}
+
+		Parameters(const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters) :
+			ImageLevelParser<Precision, ImageType>::Parameters(parameters) {}
+
+		/**
+		 * The directory to store the temporary files in. If empty, the
+		 * temporary directory of the system is used.
+		 */
+		std::string tempDirectory;
+	};
+
+	/**
+	 * Create a new streaming level parser for an image of the given size. 
+	 * Pixels are stored as 32-bit linear indices, therefore the image can 
+	 * have at most 2^32 - 1 pixels.
+	 */
+	StreamingLevelParser(unsigned int width, unsigned int height, const Parameters& parameters = Parameters());
+
+	/**
+	 * Removes the temporary files.
+	 */
+	~StreamingLevelParser();
+
+	/**
+	 * Add the next rows of the image. The given image has to have the width
+	 * of the whole image.
+	 */
+	void addRows(const ImageType& rows);
+
+	/**
+	 * Parse the image, after all rows have been added. The provided visitor
+	 * has to implement the interface of ImageLevelParser::Visitor (but does
+	 * not need to inherit from it). The memory needed is proportional to the 
+	 * size of the image, see the class documentation.
+	 */
+	template <typename VisitorType>
+	void parse(VisitorType& visitor);
+
+	/**
+	 * Get the original value that corresponds to the given level (see 
+	 * ImageLevelParser::getOriginalValue()).
+	 */
+	typename ImageType::value_type getOriginalValue(Precision level) const {
+		return _discretizer.getOriginalValue(level);
+	}
+
+private:
+
+	/**
+	 * A component of the image. While adding strips, nodes are identified by
+	 * their position in _nodes, and parent refers to this position. In the
+	 * temporary file and while parsing, nodes are identified by their id.
+	 */
+	struct Node {
+
+		// unique id of the node, in order of creation
+		unsigned int id;
+
+		// the parent node, or the node itself for the root
+		unsigned int parent;
+
+		// the number of pixels of this node that are not part of any child
+		// node (only the even locations for spaced edge images)
+		unsigned int size;
+
+		// the first pixel (linear index) of this node that is not part of any
+		// child node
+		unsigned int first;
+
+		Precision level;
+	};
+
+	/**
+	 * Sort the linear indices of the pixels of the current strip by their
+	 * level into _sorted.
+	 */
+	void sortPixels() {
+		sortPixelsImpl(std::integral_constant<bool, sizeof(Precision) <= 2>());
+	}
+	void sortPixelsImpl(std::true_type);
+	void sortPixelsImpl(std::false_type);
+
+	/**
+	 * Build the pixel tree of the current strip (see
+	 * UnionFindParser::buildPixelTree()).
+	 */
+	void buildPixelTree();
+
+	/**
+	 * Create a node for each component of the pixel tree of the current
+	 * strip, and store the node of each pixel in _zpar.
+	 */
+	void createNodes();
+
+	/**
+	 * Merge the components of two neighboring nodes and all their ancestors
+	 * (see UnionFindParser::connect()).
+	 */
+	void connect(unsigned int a, unsigned int b);
+
+	/**
+	 * Find the canonical node of the component of the given node.
+	 */
+	inline unsigned int levelRoot(unsigned int node) const {
+
+		while (_nodes[node].parent != node && _nodes[_nodes[node].parent].level == _nodes[node].level)
+			node = _nodes[node].parent;
+
+		return node;
+	}
+
+	/**
+	 * Write all nodes that are not an ancestor of a frontier pixel to the
+	 * temporary file, or all nodes if all is set.
+	 */
+	void spill(bool all);
+
+	/**
+	 * Read the nodes from the temporary file, let each node point to its
+	 * canonical node, and accumulate the sizes of the canonical nodes.
+	 */
+	void readNodes();
+
+	/**
+	 * Collect the children of each canonical node, ordered by their first
+	 * pixel.
+	 */
+	void collectChildren();
+
+	/**
+	 * Decide for each canonical node whether the visitor is invoked for it 
+	 * (see UnionFindParser::buildComponentTree()).
+	 */
+	void findReportedNodes(unsigned int rootNode);
+
+	/**
+	 * Fill the pixel list with the pixels of each node, depth first and after
+	 * the pixels of its children.
+	 */
+	void fillPixelList();
+
+	/**
+	 * Find the root of the union-find set of the given pixel, with path
+	 * compression.
+	 */
+	inline unsigned int findRoot(unsigned int pixel) {
+
+		while (_zpar[pixel] != pixel) {
+
+			_zpar[pixel] = _zpar[_zpar[pixel]];
+			pixel = _zpar[pixel];
+		}
+
+		return pixel;
+	}
+
+	/**
+	 * Is the given pixel an even location of the spaced edge image?
+	 */
+	inline bool isCondensed(unsigned int pixel) const {
+
+		return ((pixel % _width) % 2 == 0 && (pixel / _width) % 2 == 0);
+	}
+
+	/**
+	 * Create and open a temporary file in the given directory.
+	 */
+	static void openTempFile(
+			const boost::filesystem::path& directory,
+			const std::string&             suffix,
+			boost::filesystem::path&       filename,
+			std::fstream&                  file);
+
+	static const Precision MaxValue;
+
+	// the number of nodes or pixels to read from the temporary files at once
+	static const size_t ChunkSize = 1 << 16;
+
+	// maps between original intensities and levels
+	ImageDiscretizer<Precision, ImageType> _discretizer;
+
+	// parameters of the parsing algorithm
+	Parameters _parameters;
+
+	unsigned int _width;
+	unsigned int _height;
+
+	// the number of rows that have been added so far
+	unsigned int _row;
+
+	// discretized version of the current strip
+	vigra::MultiArray<2, Precision> _strip;
+
+	// linear indices of the pixels of the current strip, sorted by level
+	std::vector<unsigned int> _sorted;
+
+	// parent of each pixel of the current strip in its pixel tree
+	std::vector<unsigned int> _parent;
+
+	// union-find forest while building the pixel tree, afterwards the node
+	// of each pixel of the current strip
+	std::vector<unsigned int> _zpar;
+
+	// the open nodes while adding strips, all nodes by id while parsing
+	std::vector<Node> _nodes;
+
+	// the number of nodes created so far, i.e., the next node id
+	unsigned int _numNodes;
+
+	// the node of each pixel in the last row that has been added
+	std::vector<unsigned int> _frontier;
+
+	// the nodes that are final, and the node id of each pixel
+	boost::filesystem::path _nodesFilename;
+	boost::filesystem::path _pixelsFilename;
+	std::fstream            _nodesFile;
+	std::fstream            _pixelsFile;
+
+	// the children of each node while parsing, stored in
+	// _nodeChildren[_nodeChildrenBegin[i]] to _nodeChildren[_nodeChildrenBegin[i+1]]
+	std::vector<unsigned int> _nodeChildrenBegin;
+	std::vector<unsigned int> _nodeChildren;
+
+	// whether the visitor is invoked for each node while parsing, which is 
+	// not the case for empty or duplicate condensed components of spaced 
+	// edge images
+	std::vector<bool> _nodeReported;
+
+	// the pixel list, shared ownership with visitors
+	boost::shared_ptr<PixelList> _pixelList;
+};
+
+template <typename Precision, typename ImageType>
+const Precision StreamingLevelParser<Precision, ImageType>::MaxValue = std::numeric_limits<Precision>::max();
+template <typename Precision, typename ImageType>
+const size_t StreamingLevelParser<Precision, ImageType>::ChunkSize;
+
+template <typename Precision, typename ImageType>
+StreamingLevelParser<Precision, ImageType>::StreamingLevelParser(
+		unsigned int      width,
+		unsigned int      height,
+		const Parameters& parameters) :
+	_parameters(parameters),
+	_width(width),
+	_height(height),
+	_row(0),
+	_numNodes(0) {
+
+	// pixels and nodes are identified by unsigned ints
+	if (static_cast<size_t>(width)*height > std::numeric_limits<unsigned int>::max())
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"image of size " << width << "x" << height << " is too large for StreamingLevelParser");
+
+	if (_parameters.rankTransform || _parameters.quantiles) {
+
+		LOG_ERROR(streaminglevelparserlog)
+				<< "rank transform and quantiles are not supported for streaming, "
+				<< "using linear discretization" << std::endl;
+
+		_parameters.rankTransform = false;
+		_parameters.quantiles     = false;
+	}
+
+	_discretizer = ImageDiscretizer<Precision, ImageType>(
+			_parameters.darkToBright,
+			_parameters.minIntensity,
+			_parameters.maxIntensity);
+
+	boost::filesystem::path directory =
+			(_parameters.tempDirectory.empty() ?
+			 boost::filesystem::temp_directory_path() :
+			 boost::filesystem::path(_parameters.tempDirectory));
+
+	openTempFile(directory, "nodes", _nodesFilename, _nodesFile);
+
+	try {
+
+		openTempFile(directory, "pixels", _pixelsFilename, _pixelsFile);
+
+	} catch (...) {
+
+		// the destructor is not called if the constructor throws
+		_nodesFile.close();
+
+		boost::system::error_code error;
+		boost::filesystem::remove(_nodesFilename, error);
+
+		throw;
+	}
+
+	LOG_ALL(streaminglevelparserlog)
+			<< "initializing for image of size " << width << "x" << height
+			<< ", using temporary files " << _nodesFilename << " and " << _pixelsFilename << std::endl;
+}
+
+template <typename Precision, typename ImageType>
+StreamingLevelParser<Precision, ImageType>::~StreamingLevelParser() {
+
+	_nodesFile.close();
+	_pixelsFile.close();
+
+	boost::system::error_code error;
+	boost::filesystem::remove(_nodesFilename, error);
+	boost::filesystem::remove(_pixelsFilename, error);
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::openTempFile(
+		const boost::filesystem::path& directory,
+		const std::string&             suffix,
+		boost::filesystem::path&       filename,
+		std::fstream&                  file) {
+
+	filename = directory / boost::filesystem::unique_path("streaminglevelparser-%%%%-%%%%-%%%%-%%%%." + suffix);
+
+	file.open(filename.string().c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not create temporary file " << filename);
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::addRows(const ImageType& rows) {
+
+	if (rows.width() != _width || _row + rows.height() > _height)
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"can not add " << rows.width() << "x" << rows.height() << " pixels at row " << _row <<
+				" of an image of size " << _width << "x" << _height);
+
+	if (rows.size() == 0)
+		return;
+
+	LOG_ALL(streaminglevelparserlog)
+			<< "adding rows " << _row << " to " << (_row + rows.height()) << std::endl;
+
+	_discretizer.discretize(rows, _strip);
+
+	_sorted.resize(_strip.size());
+	_parent.resize(_strip.size());
+	_zpar.resize(_strip.size());
+
+	sortPixels();
+	buildPixelTree();
+	createNodes();
+
+	// merge with the components of the previous rows
+	if (_row > 0)
+		for (unsigned int x = 0; x < _width; x++)
+			connect(_frontier[x], _zpar[x]);
+
+	// store the node of each pixel (the sorted pixels are not needed anymore)
+	for (unsigned int pixel = 0; pixel < _strip.size(); pixel++)
+		_sorted[pixel] = _nodes[_zpar[pixel]].id;
+
+	_pixelsFile.write(reinterpret_cast<const char*>(_sorted.data()), _sorted.size()*sizeof(unsigned int));
+
+	if (!_pixelsFile)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not write to temporary file " << _pixelsFilename);
+
+	_frontier.assign(_zpar.end() - _width, _zpar.end());
+	_row += rows.height();
+
+	spill(false);
+
+	LOG_ALL(streaminglevelparserlog)
+			<< _nodes.size() << " nodes are open after row " << _row << std::endl;
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::sortPixelsImpl(std::true_type) {
+
+	const Precision* levels = _strip.data();
+	const unsigned int size = _strip.size();
+
+	// counting sort
+	std::vector<unsigned int> counts(static_cast<size_t>(MaxValue) + 2, 0);
+	for (unsigned int i = 0; i < size; i++)
+		counts[static_cast<size_t>(levels[i]) + 1]++;
+	for (size_t level = 1; level < counts.size(); level++)
+		counts[level] += counts[level - 1];
+
+	for (unsigned int i = 0; i < size; i++)
+		_sorted[counts[levels[i]]++] = i;
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::sortPixelsImpl(std::false_type) {
+
+	const Precision* levels = _strip.data();
+
+	for (unsigned int i = 0; i < _sorted.size(); i++)
+		_sorted[i] = i;
+
+	std::stable_sort(
+			_sorted.begin(),
+			_sorted.end(),
+			[levels](unsigned int a, unsigned int b) { return levels[a] < levels[b]; });
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::buildPixelTree() {
+
+	const unsigned int size = _strip.size();
+	const Precision* levels = _strip.data();
+
+	// mark all pixels as not processed
+	std::fill(_zpar.begin(), _zpar.end(), size);
+
+	for (unsigned int i = 0; i < size; i++) {
+
+		unsigned int pixel = _sorted[i];
+		unsigned int x = pixel % _width;
+
+		_parent[pixel] = pixel;
+		_zpar[pixel]   = pixel;
+
+		unsigned int neighbors[4];
+		int numNeighbors = 0;
+		if (x > 0)                neighbors[numNeighbors++] = pixel - 1;
+		if (x < _width - 1)       neighbors[numNeighbors++] = pixel + 1;
+		if (pixel >= _width)      neighbors[numNeighbors++] = pixel - _width;
+		if (pixel + _width < size) neighbors[numNeighbors++] = pixel + _width;
+
+		for (int n = 0; n < numNeighbors; n++) {
+
+			if (_zpar[neighbors[n]] == size)
+				continue;
+
+			unsigned int root = findRoot(neighbors[n]);
+
+			if (root != pixel) {
+
+				_parent[root] = pixel;
+				_zpar[root]   = pixel;
+			}
+		}
+	}
+
+	// let the parent of each pixel point to the canonical pixel of its
+	// component (the parents are processed before their children here)
+	for (unsigned int i = size; i-- > 0;) {
+
+		unsigned int pixel  = _sorted[i];
+		unsigned int parent = _parent[pixel];
+
+		if (levels[_parent[parent]] == levels[parent])
+			_parent[pixel] = _parent[parent];
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::createNodes() {
+
+	const unsigned int size = _strip.size();
+	const Precision* levels = _strip.data();
+	const unsigned int offset = _row*_width;
+
+	// _zpar is not needed anymore and stores the node of each pixel from now
+	// on
+	std::vector<unsigned int>& nodeOf = _zpar;
+
+	const unsigned int firstNode = _nodes.size();
+
+	for (unsigned int pixel = 0; pixel < size; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent != pixel && levels[parent] == levels[pixel])
+			continue;
+
+		Node node = { _numNodes, 0, 0, offset + pixel, levels[pixel] };
+		_numNodes++;
+
+		nodeOf[pixel] = _nodes.size();
+		_nodes.push_back(node);
+	}
+
+	for (unsigned int pixel = 0; pixel < size; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent == pixel)
+			_nodes[nodeOf[pixel]].parent = nodeOf[pixel];
+		else if (levels[parent] != levels[pixel])
+			_nodes[nodeOf[pixel]].parent = nodeOf[parent];
+	}
+
+	// the parents of non-canonical pixels are canonical
+	for (unsigned int pixel = 0; pixel < size; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent != pixel && levels[parent] == levels[pixel])
+			nodeOf[pixel] = nodeOf[parent];
+	}
+
+	// count the pixels of each node and find its first pixel
+	for (unsigned int pixel = 0; pixel < size; pixel++) {
+
+		Node& node = _nodes[nodeOf[pixel]];
+
+		node.first = std::min(node.first, offset + pixel);
+
+		if (!_parameters.spacedEdgeImage || isCondensed(offset + pixel))
+			node.size++;
+	}
+
+	LOG_ALL(streaminglevelparserlog)
+			<< "created " << (_nodes.size() - firstNode) << " nodes" << std::endl;
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::connect(unsigned int a, unsigned int b) {
+
+	a = levelRoot(a);
+	b = levelRoot(b);
+
+	// merge the two chains of ancestors, which are both sorted by level
+	while (a != b) {
+
+		if (_nodes[a].level > _nodes[b].level)
+			std::swap(a, b);
+
+		if (_nodes[a].parent == a) {
+
+			_nodes[a].parent = b;
+			return;
+		}
+
+		unsigned int ancestor = levelRoot(_nodes[a].parent);
+
+		if (_nodes[a].level < _nodes[b].level && _nodes[ancestor].level <= _nodes[b].level) {
+
+			// b is not between a and its ancestor, go up
+			a = ancestor;
+
+		} else {
+
+			// b is between a and its ancestor (or at the same level as a),
+			// continue with b and the ancestor
+			_nodes[a].parent = b;
+			a = b;
+			b = ancestor;
+		}
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::spill(bool all) {
+
+	const unsigned int NoNode = std::numeric_limits<unsigned int>::max();
+
+	// the new position of each node that stays open
+	std::vector<unsigned int> open(_nodes.size(), NoNode);
+
+	// Mark the ancestors of the frontier pixels. The parent of an open node
+	// is open as well, since we only stop at nodes whose ancestors are
+	// marked already.
+	if (!all)
+		for (unsigned int x = 0; x < _width; x++)
+			for (unsigned int node = levelRoot(_frontier[x]); open[node] == NoNode;) {
+
+				open[node] = 0;
+
+				if (_nodes[node].parent == node)
+					break;
+
+				node = levelRoot(_nodes[node].parent);
+			}
+
+	std::vector<Node> openNodes;
+	std::vector<Node> finalNodes;
+
+	for (unsigned int node = 0; node < _nodes.size(); node++) {
+
+		Node n = _nodes[node];
+		n.parent = levelRoot(n.parent);
+
+		if (open[node] == NoNode) {
+
+			n.parent = _nodes[n.parent].id;
+			finalNodes.push_back(n);
+
+		} else {
+
+			open[node] = openNodes.size();
+			openNodes.push_back(n);
+		}
+	}
+
+	for (unsigned int x = 0; x < _frontier.size(); x++)
+		_frontier[x] = open[levelRoot(_frontier[x])];
+
+	for (unsigned int node = 0; node < openNodes.size(); node++)
+		openNodes[node].parent = open[openNodes[node].parent];
+
+	_nodes.swap(openNodes);
+
+	_nodesFile.write(reinterpret_cast<const char*>(finalNodes.data()), finalNodes.size()*sizeof(Node));
+
+	if (!_nodesFile)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not write to temporary file " << _nodesFilename);
+
+	LOG_ALL(streaminglevelparserlog)
+			<< "wrote " << finalNodes.size() << " final nodes" << std::endl;
+}
+
+template <typename Precision, typename ImageType>
+template <typename VisitorType>
+void
+StreamingLevelParser<Precision, ImageType>::parse(VisitorType& visitor) {
+
+	LOG_ALL(streaminglevelparserlog) << "parsing image" << std::endl;
+
+	if (_row != _height)
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"only " << _row << " of " << _height << " rows have been added");
+
+	if (static_cast<size_t>(_width)*_height == 0) {
+
+		_pixelList = boost::make_shared<PixelList>(0, _width);
+		visitor.setPixelList(_pixelList);
+		return;
+	}
+
+	_frontier.clear();
+	spill(true);
+
+	_nodesFile.flush();
+	_pixelsFile.flush();
+
+	if (!_nodesFile || !_pixelsFile)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not write to temporary files " << _nodesFilename << " and " << _pixelsFilename);
+
+	readNodes();
+	collectChildren();
+	fillPixelList();
+
+	visitor.setPixelList(_pixelList);
+
+	LOG_ALL(streaminglevelparserlog)
+			<< "found " << (_nodeChildren.size() + 1) << " components" << std::endl;
+
+	// depth first traversal of the component tree, the pixel list is filled
+	// already in the order of the traversal
+
+	struct Frame {
+
+		unsigned int        node;
+		unsigned int        nextChild;
+		size_t              begin;
+		ComponentAttributes attributes;
+	};
+
+	typedef VisitorCallbacks<VisitorType, Visitor, Precision, typename ImageType::value_type> callbacks;
+
+	std::vector<Frame> stack;
+	stack.reserve(64);
+
+	unsigned int rootNode = 0;
+	while (_nodes[rootNode].parent != rootNode)
+		rootNode = _nodes[rootNode].parent;
+
+	findReportedNodes(rootNode);
+
+	size_t end = 0;
+
+	Frame root = { rootNode, _nodeChildrenBegin[rootNode], end, ComponentAttributes() };
+	stack.push_back(root);
+	if (_nodeReported[rootNode])
+		callbacks::newChild(visitor, _nodes[rootNode].level, _discretizer);
+
+	while (!stack.empty()) {
+
+		Frame& frame = stack.back();
+		unsigned int node = frame.node;
+
+		if (frame.nextChild < _nodeChildrenBegin[node + 1]) {
+
+			unsigned int child = _nodeChildren[frame.nextChild];
+			frame.nextChild++;
+
+			Frame childFrame = { child, _nodeChildrenBegin[child], end, ComponentAttributes() };
+			stack.push_back(childFrame);
+			if (_nodeReported[child])
+				callbacks::newChild(visitor, _nodes[child].level, _discretizer);
+
+			continue;
+		}
+
+		PixelList::const_iterator begin = _pixelList->begin() + end;
+
+		if (callbacks::AcceptsAttributes)
+			for (PixelList::const_iterator i = begin; i != begin + _nodes[node].size; i++)
+				frame.attributes.add(i->x(), i->y(), _nodes[node].level);
+
+		end += _nodes[node].size;
+
+		const size_t componentBegin = frame.begin;
+		const ComponentAttributes attributes = frame.attributes;
+		stack.pop_back();
+
+		// the pixels of this component are also pixels of its parent
+		if (callbacks::AcceptsAttributes && !stack.empty())
+			stack.back().attributes.merge(attributes);
+
+		if (_nodeReported[node])
+			callbacks::finalize(
+					visitor,
+					_nodes[node].level,
+					_discretizer,
+					_pixelList->begin() + componentBegin,
+					_pixelList->begin() + end,
+					attributes);
+	}
+
+	// the nodes can be read again from the temporary file
+	std::vector<Node>().swap(_nodes);
+	std::vector<unsigned int>().swap(_nodeChildrenBegin);
+	std::vector<unsigned int>().swap(_nodeChildren);
+	std::vector<bool>().swap(_nodeReported);
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::readNodes() {
+
+	_nodes.resize(_numNodes);
+
+	std::vector<Node> chunk(ChunkSize);
+
+	_nodesFile.seekg(0);
+
+	for (size_t read = 0; read < _numNodes; read += chunk.size()) {
+
+		chunk.resize(std::min(ChunkSize, _numNodes - read));
+		_nodesFile.read(reinterpret_cast<char*>(chunk.data()), chunk.size()*sizeof(Node));
+
+		if (!_nodesFile)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"can not read from temporary file " << _nodesFilename);
+
+		for (typename std::vector<Node>::const_iterator i = chunk.begin(); i != chunk.end(); i++)
+			_nodes[i->id] = *i;
+	}
+
+	// let non-canonical nodes point to their canonical node directly
+	for (unsigned int node = 0; node < _numNodes; node++) {
+
+		unsigned int root = levelRoot(node);
+
+		for (unsigned int n = node; n != root;) {
+
+			unsigned int next = _nodes[n].parent;
+			_nodes[n].parent = root;
+			n = next;
+		}
+	}
+
+	// canonical nodes point to canonical parents, non-canonical nodes add
+	// their pixels to their canonical node
+	for (unsigned int node = 0; node < _numNodes; node++) {
+
+		unsigned int root = levelRoot(node);
+
+		if (root == node) {
+
+			_nodes[node].parent = levelRoot(_nodes[node].parent);
+
+		} else {
+
+			_nodes[root].size  += _nodes[node].size;
+			_nodes[root].first  = std::min(_nodes[root].first, _nodes[node].first);
+			_nodes[node].size   = 0;
+		}
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::collectChildren() {
+
+	// non-root canonical nodes, ordered by their first pixel (such that the
+	// traversal order is the same as for UnionFindParser)
+	std::vector<std::pair<unsigned int, unsigned int> > children;
+	for (unsigned int node = 0; node < _numNodes; node++)
+		if (levelRoot(node) == node && _nodes[node].parent != node)
+			children.push_back(std::make_pair(_nodes[node].first, node));
+
+	std::sort(children.begin(), children.end());
+
+	_nodeChildrenBegin.assign(_numNodes + 1, 0);
+	for (unsigned int i = 0; i < children.size(); i++)
+		_nodeChildrenBegin[_nodes[children[i].second].parent + 1]++;
+	for (unsigned int node = 0; node < _numNodes; node++)
+		_nodeChildrenBegin[node + 1] += _nodeChildrenBegin[node];
+
+	_nodeChildren.resize(children.size());
+
+	std::vector<unsigned int> next(_nodeChildrenBegin.begin(), _nodeChildrenBegin.end() - 1);
+	for (unsigned int i = 0; i < children.size(); i++)
+		_nodeChildren[next[_nodes[children[i].second].parent]++] = children[i].second;
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::findReportedNodes(unsigned int rootNode) {
+
+	_nodeReported.assign(_numNodes, true);
+
+	if (!_parameters.spacedEdgeImage)
+		return;
+
+	// the canonical nodes in breadth first order, such that children are 
+	// processed before their parents in reverse order
+	std::vector<unsigned int> order;
+	order.push_back(rootNode);
+	for (size_t i = 0; i < order.size(); i++)
+		order.insert(
+				order.end(),
+				_nodeChildren.begin() + _nodeChildrenBegin[order[i]],
+				_nodeChildren.begin() + _nodeChildrenBegin[order[i] + 1]);
+
+	// the number of condensed pixels in the subtree of each node
+	std::vector<unsigned int> subtreeSize(_numNodes, 0);
+
+	for (size_t i = order.size(); i-- > 0;) {
+
+		unsigned int node        = order[i];
+		unsigned int numNonEmpty = 0;
+
+		subtreeSize[node] = _nodes[node].size;
+
+		for (unsigned int c = _nodeChildrenBegin[node]; c < _nodeChildrenBegin[node + 1]; c++) {
+
+			unsigned int childSize = subtreeSize[_nodeChildren[c]];
+
+			subtreeSize[node] += childSize;
+			if (childSize > 0)
+				numNonEmpty++;
+		}
+
+		if (subtreeSize[node] == 0 || (_nodes[node].size == 0 && numNonEmpty == 1))
+			_nodeReported[node] = false;
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+StreamingLevelParser<Precision, ImageType>::fillPixelList() {
+
+	// Find the position of the pixels of each node in the pixel list, which
+	// follow the pixels of its children. The first pixel of a node is not
+	// needed anymore and stores the next position from now on.
+
+	unsigned int rootNode = 0;
+	while (_nodes[rootNode].parent != rootNode)
+		rootNode = _nodes[rootNode].parent;
+
+	std::vector<std::pair<unsigned int, unsigned int> > stack;
+	stack.push_back(std::make_pair(rootNode, _nodeChildrenBegin[rootNode]));
+
+	unsigned int end = 0;
+
+	while (!stack.empty()) {
+
+		unsigned int node = stack.back().first;
+		unsigned int& nextChild = stack.back().second;
+
+		if (nextChild < _nodeChildrenBegin[node + 1]) {
+
+			unsigned int child = _nodeChildren[nextChild];
+			nextChild++;
+			stack.push_back(std::make_pair(child, _nodeChildrenBegin[child]));
+
+			continue;
+		}
+
+		_nodes[node].first = end;
+		end += _nodes[node].size;
+
+		stack.pop_back();
+	}
+
+	// put the pixels at their positions, in index order within each node
+
+	const unsigned int condensedWidth = (_width + 1)/2;
+
+	std::vector<unsigned int> pixels(end);
+	std::vector<unsigned int> chunk(ChunkSize);
+
+	_pixelsFile.seekg(0);
+
+	const size_t size = static_cast<size_t>(_width)*_height;
+
+	for (size_t read = 0; read < size; read += chunk.size()) {
+
+		chunk.resize(std::min(ChunkSize, size - read));
+		_pixelsFile.read(reinterpret_cast<char*>(chunk.data()), chunk.size()*sizeof(unsigned int));
+
+		if (!_pixelsFile)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"can not read from temporary file " << _pixelsFilename);
+
+		for (unsigned int i = 0; i < chunk.size(); i++) {
+
+			unsigned int pixel = read + i;
+			unsigned int node  = _nodes[chunk[i]].parent;
+
+			// the parents of non-canonical nodes are canonical
+			if (_nodes[node].level != _nodes[chunk[i]].level || node == chunk[i])
+				node = chunk[i];
+
+			if (!_parameters.spacedEdgeImage)
+				pixels[_nodes[node].first++] = pixel;
+			else if (isCondensed(pixel))
+				pixels[_nodes[node].first++] = ((pixel/_width)/2)*condensedWidth + (pixel % _width)/2;
+		}
+	}
+
+	_pixelList = boost::make_shared<PixelList>(
+			pixels,
+			(_parameters.spacedEdgeImage ? condensedWidth : _width));
+}
+
+#endif // IMAGEPROCESSING_STREAMING_LEVEL_PARSER_H__
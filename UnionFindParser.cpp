@@ -0,0 +1,3 @@
+#include "UnionFindParser.h"
+
+logger::LogChannel unionfindparserlog("unionfindparserlog", "[UnionFindParser] ");
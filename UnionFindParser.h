@@ -0,0 +1,799 @@
+#ifndef IMAGEPROCESSING_UNION_FIND_PARSER_H__
+#define IMAGEPROCESSING_UNION_FIND_PARSER_H__
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include <util/Logger.h>
+#include "PixelList.h"
+#include "Image.h"
+#include "ImageDiscretizer.h"
+#include "ImageLevelParser.h"
+#include "ComponentAttributes.h"
+#include "VisitorCallbacks.h"
+
+extern logger::LogChannel unionfindparserlog;
+
+/**
+ * An alternative to ImageLevelParser that builds the component tree with a
+ * union-find algorithm (Berger et al., "Effective component tree computation
+ * with application to pattern recognition in astronomical imaging", 2007)
+ * instead of flooding the image.
+ *
+ * The pixels are sorted by their level (using a counting sort for precisions
+ * of up to 16 bit), merged in increasing order into the components of their
+ * already processed neighbors, and the resulting tree is finally traversed
+ * depth first to fill the pixel list and invoke the visitor. There is no
+ * recursion involved, and the memory access pattern is more regular than the
+ * one of the flooding algorithm.
+ *
+ * Parameters and visitors are the same as for ImageLevelParser. The visitor is
+ * called once for every distinct connected component (with the value of the
+ * lowest threshold that produces it), i.e., the components are the same as
+ * the ones of an ImageLevelParser with skipEmptyLevels set, after removing
+ * components that are identical to their only child. The order differs,
+ * however: Children are still reported before their parents, but siblings
+ * are visited in the order of their first pixel (in index order), and the
+ * pixels of a component are in index order instead of flood order.
+ *
+ * For spaced edge images, only the even (condensed) locations are added to
+ * the pixel list. Components without condensed pixels, and components with
+ * the same condensed pixels as one of their descendants, are not reported;
+ * their pixels and children belong to the closest reported ancestor.
+ *
+ * The pixel tree can be built in parallel: The image is split into horizontal
+ * strips of rows (tiles), the pixel tree of each tile is built on its own
+ * thread, and the trees of neighboring tiles are merged along their borders
+ * (Wilkinson et al., "Concurrent computation of attribute filters on shared
+ * memory parallel machines", 2008). The nodes of the component tree are
+ * created per tile as well. The resulting components and the order of the
+ * visitor callbacks do not depend on the number of tiles.
+ *
+ * The remaining steps are serial: collecting the pixels and children of each
+ * node (four passes over the pixels and nodes), and the depth first traversal
+ * that invokes the visitor. The speedup with more threads is therefore well
+ * below linear. Memory does not depend on the number of tiles either: Besides
+ * the pixel list, the parser keeps 12 bytes per pixel (the sorted pixels, the
+ * pixel tree, and the union-find forest) and about 25 bytes per node, for up
+ * to one node per pixel.
+ */
+template <typename Precision = unsigned char, typename ImageType = IntensityImage>
+class UnionFindParser {
+
+public:
+
+	typedef typename ImageLevelParser<Precision, ImageType>::Visitor Visitor;
+
+	/**
+	 * Parameters of the union-find parser. Same as for ImageLevelParser, with 
+	 * the addition of the number of threads.
+	 */
+	struct Parameters : public ImageLevelParser<Precision, ImageType>::Parameters {
+
+		Parameters() : numThreads(1) {}
+
+		Parameters(const typename ImageLevelParser<Precision, ImageType>::Parameters& parameters) :
+			ImageLevelParser<Precision, ImageType>::Parameters(parameters),
+			numThreads(1) {}
+
+		/**
+		 * The number of tiles to build the pixel tree and the nodes for in 
+		 * parallel. Each tile is a strip of at least one row of the image, 
+		 * such that at most as many tiles as rows are used. Collecting the 
+		 * pixels of each node and the traversal stay serial, and the memory 
+		 * used is the same as for a single tile.
+		 */
+		unsigned int numThreads;
+	};
+
+	/**
+	 * Create a new union-find parser for the given image with the given
+	 * parameters.
+	 */
+	UnionFindParser(const ImageType& image, const Parameters& parameters = Parameters());
+
+	/**
+	 * Parse the image. The provided visitor has to implement the interface of
+	 * ImageLevelParser::Visitor (but does not need to inherit from it).
+	 */
+	template <typename VisitorType>
+	void parse(VisitorType& visitor);
+
+	/**
+	 * Get the original value that corresponds to the given level (see 
+	 * ImageLevelParser::getOriginalValue()).
+	 */
+	typename ImageType::value_type getOriginalValue(Precision level) const {
+		return _discretizer.getOriginalValue(level);
+	}
+
+private:
+
+	/**
+	 * Build the pixel tree for the pixels in [begin, end), which have to be a 
+	 * range of complete rows. Pixels outside the range are not considered.
+	 */
+	void processTile(unsigned int begin, unsigned int end);
+
+	/**
+	 * Sort the linear indices of the pixels in [begin, end) by their level 
+	 * into _sorted[begin, end). Pixels of the same level are sorted by their 
+	 * index.
+	 */
+	void sortPixels(unsigned int begin, unsigned int end) {
+		sortPixelsImpl(begin, end, std::integral_constant<bool, sizeof(Precision) <= 2>());
+	}
+	void sortPixelsImpl(unsigned int begin, unsigned int end, std::true_type);
+	void sortPixelsImpl(unsigned int begin, unsigned int end, std::false_type);
+
+	/**
+	 * Merge the sorted pixels in [begin, end) into the pixel tree stored in 
+	 * _parent, such that the parent of each pixel is the canonical pixel of 
+	 * its component within the range.
+	 */
+	void buildPixelTree(unsigned int begin, unsigned int end);
+
+	/**
+	 * Merge the pixel trees of the tiles above and below the given row.
+	 */
+	void mergeTiles(unsigned int row);
+
+	/**
+	 * Merge the components of two neighboring pixels and all their 
+	 * ancestors.
+	 */
+	void connect(unsigned int a, unsigned int b);
+
+	/**
+	 * Find the canonical pixel of the component of the given pixel.
+	 */
+	inline unsigned int levelRoot(unsigned int pixel) const {
+
+		const Precision* levels = _image.data();
+
+		while (_parent[pixel] != pixel && levels[_parent[pixel]] == levels[pixel])
+			pixel = _parent[pixel];
+
+		return pixel;
+	}
+
+	/**
+	 * Store the canonical pixel of each pixel in [begin, end) in _zpar, and 
+	 * let the parents point to canonical pixels afterwards. Used after 
+	 * merging tiles, where the parents of pixels can point to non-canonical 
+	 * pixels.
+	 */
+	void findLevelRoots(unsigned int begin, unsigned int end);
+	void setLevelRoots(unsigned int begin, unsigned int end);
+
+	/**
+	 * Invoke the given method for each tile, in parallel if there are several 
+	 * tiles.
+	 */
+	void forEachTile(void (UnionFindParser::*method)(unsigned int, unsigned int));
+
+	/**
+	 * Create the component tree nodes from the pixel tree, together with the
+	 * pixels and children of each node.
+	 */
+	void buildComponentTree();
+
+	/**
+	 * Count the canonical pixels in [begin, end), i.e., the nodes of the 
+	 * tile.
+	 */
+	void countNodes(unsigned int begin, unsigned int end);
+
+	/**
+	 * Create a node for each canonical pixel in [begin, end), numbered in 
+	 * index order starting at the first node of the tile.
+	 */
+	void createNodes(unsigned int begin, unsigned int end);
+
+	/**
+	 * Set the parents of the nodes of the canonical pixels in [begin, end), 
+	 * and the nodes of the other pixels.
+	 */
+	void linkNodes(unsigned int begin, unsigned int end);
+
+	/**
+	 * Get the tile that starts with the given pixel.
+	 */
+	unsigned int getTile(unsigned int begin) const {
+
+		return std::upper_bound(_tileRows.begin(), _tileRows.end(), begin/_width) - _tileRows.begin() - 1;
+	}
+
+	/**
+	 * Find the root of the union-find set of the given pixel, with path
+	 * compression.
+	 */
+	inline unsigned int findRoot(unsigned int pixel) {
+
+		while (_zpar[pixel] != pixel) {
+
+			_zpar[pixel] = _zpar[_zpar[pixel]];
+			pixel = _zpar[pixel];
+		}
+
+		return pixel;
+	}
+
+	/**
+	 * Is the given pixel an even location of the spaced edge image?
+	 */
+	inline bool isCondensed(unsigned int pixel) const {
+
+		return ((pixel % _width) % 2 == 0 && (pixel / _width) % 2 == 0);
+	}
+
+	static const Precision MaxValue;
+
+	// discretized version of the input image
+	vigra::MultiArray<2, Precision> _image;
+
+	// maps between original intensities and levels
+	ImageDiscretizer<Precision, ImageType> _discretizer;
+
+	// parameters of the parsing algorithm
+	Parameters _parameters;
+
+	unsigned int _width;
+	unsigned int _height;
+
+	// the first row of each tile, followed by the height of the image
+	std::vector<unsigned int> _tileRows;
+
+	// the first node of each tile, followed by the number of nodes
+	std::vector<unsigned int> _tileNodes;
+
+	// linear indices of all pixels, sorted by level within each tile
+	std::vector<unsigned int> _sorted;
+
+	// parent of each pixel in the pixel tree
+	std::vector<unsigned int> _parent;
+
+	// union-find forest while building the pixel tree, afterwards the node
+	// of each pixel
+	std::vector<unsigned int> _zpar;
+
+	// parent and level of each node
+	unsigned int              _rootNode;
+	std::vector<unsigned int> _nodeParent;
+	std::vector<Precision>    _nodeLevel;
+
+	// the pixels of each node that are not part of any child node, stored in
+	// _nodePixels[_nodePixelsBegin[i]] to _nodePixels[_nodePixelsBegin[i+1]]
+	std::vector<unsigned int> _nodePixelsBegin;
+	std::vector<unsigned int> _nodePixels;
+
+	// the children of each node, stored the same way
+	std::vector<unsigned int> _nodeChildrenBegin;
+	std::vector<unsigned int> _nodeChildren;
+
+	// whether the visitor is invoked for each node, which is not the case for 
+	// empty or duplicate condensed components of spaced edge images
+	std::vector<bool> _nodeReported;
+
+	// the pixel list, shared ownership with visitors
+	boost::shared_ptr<PixelList> _pixelList;
+};
+
+template <typename Precision, typename ImageType>
+const Precision UnionFindParser<Precision, ImageType>::MaxValue = std::numeric_limits<Precision>::max();
+
+template <typename Precision, typename ImageType>
+UnionFindParser<Precision, ImageType>::UnionFindParser(const ImageType& image, const Parameters& parameters) :
+	_discretizer(parameters.darkToBright, parameters.minIntensity, parameters.maxIntensity, parameters.rankTransform, parameters.quantiles),
+	_parameters(parameters),
+	_width(image.width()),
+	_height(image.height()) {
+
+	// the condensed image contains all even locations of the spaced edge
+	// image
+	if (_parameters.spacedEdgeImage)
+		_pixelList = boost::make_shared<PixelList>(
+				((_width + 1)/2)*((_height + 1)/2),
+				(_width + 1)/2);
+	else
+		_pixelList = boost::make_shared<PixelList>(image.size(), _width);
+
+	LOG_ALL(unionfindparserlog) << "initializing for image of size " << image.size() << std::endl;
+
+	_discretizer.discretize(image, _image);
+}
+
+template <typename Precision, typename ImageType>
+template <typename VisitorType>
+void
+UnionFindParser<Precision, ImageType>::parse(VisitorType& visitor) {
+
+	LOG_ALL(unionfindparserlog) << "parsing image" << std::endl;
+
+	visitor.setPixelList(_pixelList);
+
+	if (_image.size() == 0)
+		return;
+
+	unsigned int numTiles = std::max(1u, std::min(_parameters.numThreads, _height));
+
+	_tileRows.resize(numTiles + 1);
+	for (unsigned int i = 0; i <= numTiles; i++)
+		_tileRows[i] = static_cast<unsigned int>((static_cast<size_t>(_height)*i)/numTiles);
+
+	_sorted.resize(_image.size());
+	_parent.resize(_image.size());
+	_zpar.resize(_image.size());
+
+	forEachTile(&UnionFindParser::processTile);
+
+	if (numTiles > 1) {
+
+		// merge neighboring tiles in rounds, doubling the size of the merged 
+		// tiles in each round
+		for (unsigned int step = 1; step < numTiles; step *= 2) {
+
+			boost::thread_group workers;
+
+			for (unsigned int tile = 0; tile + step < numTiles; tile += 2*step)
+				workers.add_thread(
+						new boost::thread(
+								&UnionFindParser::mergeTiles,
+								this,
+								_tileRows[tile + step]));
+
+			workers.join_all();
+		}
+
+		forEachTile(&UnionFindParser::findLevelRoots);
+		forEachTile(&UnionFindParser::setLevelRoots);
+	}
+
+	buildComponentTree();
+
+	LOG_ALL(unionfindparserlog)
+			<< "found " << _nodeLevel.size() << " components" << std::endl;
+
+	// depth first traversal of the component tree: enter each node with
+	// newChildComponent, leave it with finalizeComponent after all its
+	// children and its own pixels have been added to the pixel list
+
+	struct Frame {
+
+		unsigned int              node;
+		unsigned int              nextChild;
+		PixelList::const_iterator begin;
+		ComponentAttributes       attributes;
+	};
+
+	typedef VisitorCallbacks<VisitorType, Visitor, Precision, typename ImageType::value_type> callbacks;
+
+	std::vector<Frame> stack;
+	stack.reserve(64);
+
+	Frame root = { _rootNode, _nodeChildrenBegin[_rootNode], _pixelList->end(), ComponentAttributes() };
+	stack.push_back(root);
+	if (_nodeReported[_rootNode])
+		callbacks::newChild(visitor, _nodeLevel[_rootNode], _discretizer);
+
+	while (!stack.empty()) {
+
+		Frame& frame = stack.back();
+		unsigned int node = frame.node;
+
+		if (frame.nextChild < _nodeChildrenBegin[node + 1]) {
+
+			unsigned int child = _nodeChildren[frame.nextChild];
+			frame.nextChild++;
+
+			Frame childFrame = { child, _nodeChildrenBegin[child], _pixelList->end(), ComponentAttributes() };
+			stack.push_back(childFrame);
+			if (_nodeReported[child])
+				callbacks::newChild(visitor, _nodeLevel[child], _discretizer);
+
+			continue;
+		}
+
+		for (unsigned int i = _nodePixelsBegin[node]; i < _nodePixelsBegin[node + 1]; i++) {
+
+			unsigned int pixel = _nodePixels[i];
+			util::point<unsigned int,2> location(pixel % _width, pixel / _width);
+
+			if (_parameters.spacedEdgeImage)
+				location /= 2;
+
+			_pixelList->add(location);
+
+			if (callbacks::AcceptsAttributes)
+				frame.attributes.add(location.x(), location.y(), _nodeLevel[node]);
+		}
+
+		PixelList::const_iterator begin = frame.begin;
+		const ComponentAttributes attributes = frame.attributes;
+		stack.pop_back();
+
+		// the pixels of this component are also pixels of its parent
+		if (callbacks::AcceptsAttributes && !stack.empty())
+			stack.back().attributes.merge(attributes);
+
+		if (_nodeReported[node])
+			callbacks::finalize(visitor, _nodeLevel[node], _discretizer, begin, _pixelList->end(), attributes);
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::forEachTile(void (UnionFindParser::*method)(unsigned int, unsigned int)) {
+
+	unsigned int numTiles = _tileRows.size() - 1;
+
+	if (numTiles == 1) {
+
+		(this->*method)(0, _image.size());
+		return;
+	}
+
+	boost::thread_group workers;
+
+	for (unsigned int tile = 0; tile < numTiles; tile++)
+		workers.add_thread(
+				new boost::thread(
+						method,
+						this,
+						_tileRows[tile]*_width,
+						_tileRows[tile + 1]*_width));
+
+	workers.join_all();
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::processTile(unsigned int begin, unsigned int end) {
+
+	sortPixels(begin, end);
+	buildPixelTree(begin, end);
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::sortPixelsImpl(unsigned int begin, unsigned int end, std::true_type) {
+
+	const Precision* levels = _image.data();
+
+	// counting sort
+	std::vector<unsigned int> counts(static_cast<size_t>(MaxValue) + 2, 0);
+	for (unsigned int i = begin; i < end; i++)
+		counts[static_cast<size_t>(levels[i]) + 1]++;
+	counts[0] = begin;
+	for (size_t level = 1; level < counts.size(); level++)
+		counts[level] += counts[level - 1];
+
+	for (unsigned int i = begin; i < end; i++)
+		_sorted[counts[levels[i]]++] = i;
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::sortPixelsImpl(unsigned int begin, unsigned int end, std::false_type) {
+
+	const Precision* levels = _image.data();
+
+	for (unsigned int i = begin; i < end; i++)
+		_sorted[i] = i;
+
+	std::stable_sort(
+			_sorted.begin() + begin,
+			_sorted.begin() + end,
+			[levels](unsigned int a, unsigned int b) { return levels[a] < levels[b]; });
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::buildPixelTree(unsigned int begin, unsigned int end) {
+
+	const unsigned int size = _image.size();
+	const Precision* levels = _image.data();
+
+	// mark all pixels as not processed
+	std::fill(_zpar.begin() + begin, _zpar.begin() + end, size);
+
+	for (unsigned int i = begin; i < end; i++) {
+
+		unsigned int pixel = _sorted[i];
+		unsigned int x = pixel % _width;
+
+		_parent[pixel] = pixel;
+		_zpar[pixel]   = pixel;
+
+		unsigned int neighbors[4];
+		int numNeighbors = 0;
+		if (x > 0)                    neighbors[numNeighbors++] = pixel - 1;
+		if (x < _width - 1)           neighbors[numNeighbors++] = pixel + 1;
+		if (pixel >= begin + _width)  neighbors[numNeighbors++] = pixel - _width;
+		if (pixel + _width < end)     neighbors[numNeighbors++] = pixel + _width;
+
+		for (int n = 0; n < numNeighbors; n++) {
+
+			if (_zpar[neighbors[n]] == size)
+				continue;
+
+			unsigned int root = findRoot(neighbors[n]);
+
+			if (root != pixel) {
+
+				_parent[root] = pixel;
+				_zpar[root]   = pixel;
+			}
+		}
+	}
+
+	// let the parent of each pixel point to the canonical pixel of its
+	// component (the parents are processed before their children here)
+	for (unsigned int i = end; i-- > begin;) {
+
+		unsigned int pixel  = _sorted[i];
+		unsigned int parent = _parent[pixel];
+
+		if (levels[_parent[parent]] == levels[parent])
+			_parent[pixel] = _parent[parent];
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::mergeTiles(unsigned int row) {
+
+	LOG_ALL(unionfindparserlog) << "merging tiles at row " << row << std::endl;
+
+	for (unsigned int x = 0; x < _width; x++)
+		connect((row - 1)*_width + x, row*_width + x);
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::connect(unsigned int a, unsigned int b) {
+
+	const Precision* levels = _image.data();
+
+	a = levelRoot(a);
+	b = levelRoot(b);
+
+	// merge the two chains of ancestors, which are both sorted by level
+	while (a != b) {
+
+		if (levels[a] > levels[b])
+			std::swap(a, b);
+
+		if (_parent[a] == a) {
+
+			_parent[a] = b;
+			return;
+		}
+
+		unsigned int ancestor = levelRoot(_parent[a]);
+
+		if (levels[a] < levels[b] && levels[ancestor] <= levels[b]) {
+
+			// b is not between a and its ancestor, go up
+			a = ancestor;
+
+		} else {
+
+			// b is between a and its ancestor (or at the same level as a), 
+			// continue with b and the ancestor
+			_parent[a] = b;
+			a = b;
+			b = ancestor;
+		}
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::findLevelRoots(unsigned int begin, unsigned int end) {
+
+	for (unsigned int pixel = begin; pixel < end; pixel++)
+		_zpar[pixel] = levelRoot(pixel);
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::setLevelRoots(unsigned int begin, unsigned int end) {
+
+	for (unsigned int pixel = begin; pixel < end; pixel++) {
+
+		if (_zpar[pixel] != pixel)
+			_parent[pixel] = _zpar[pixel];
+		else
+			_parent[pixel] = _zpar[_parent[pixel]];
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::buildComponentTree() {
+
+	const unsigned int size = _image.size();
+
+	// Create a node for each canonical pixel, in parallel for each tile. The 
+	// nodes are numbered in index order of their canonical pixels, 
+	// independent of the number of tiles. _zpar is not needed anymore and 
+	// stores the node of each pixel from now on.
+	std::vector<unsigned int>& nodeOf = _zpar;
+
+	_tileNodes.assign(_tileRows.size(), 0);
+	forEachTile(&UnionFindParser::countNodes);
+	for (unsigned int tile = 1; tile < _tileNodes.size(); tile++)
+		_tileNodes[tile] += _tileNodes[tile - 1];
+
+	const unsigned int numNodes = _tileNodes.back();
+
+	_nodeLevel.resize(numNodes);
+	_nodeParent.resize(numNodes);
+
+	forEachTile(&UnionFindParser::createNodes);
+	forEachTile(&UnionFindParser::linkNodes);
+
+	// collect the pixels of each node, in index order
+
+	_nodePixelsBegin.assign(numNodes + 1, 0);
+	for (unsigned int pixel = 0; pixel < size; pixel++)
+		if (!_parameters.spacedEdgeImage || isCondensed(pixel))
+			_nodePixelsBegin[nodeOf[pixel] + 1]++;
+	for (unsigned int node = 0; node < numNodes; node++)
+		_nodePixelsBegin[node + 1] += _nodePixelsBegin[node];
+
+	// the sorted pixels are not needed anymore
+	_nodePixels.swap(_sorted);
+	_nodePixels.resize(_nodePixelsBegin[numNodes]);
+
+	std::vector<unsigned int> next(_nodePixelsBegin.begin(), _nodePixelsBegin.end() - 1);
+	for (unsigned int pixel = 0; pixel < size; pixel++)
+		if (!_parameters.spacedEdgeImage || isCondensed(pixel))
+			_nodePixels[next[nodeOf[pixel]]++] = pixel;
+
+	// collect the children of each node, ordered by the first pixel of each
+	// child (such that the traversal order does not depend on the node ids)
+
+	_nodeChildrenBegin.assign(numNodes + 1, 0);
+	for (unsigned int node = 0; node < numNodes; node++)
+		if (node != _rootNode)
+			_nodeChildrenBegin[_nodeParent[node] + 1]++;
+	for (unsigned int node = 0; node < numNodes; node++)
+		_nodeChildrenBegin[node + 1] += _nodeChildrenBegin[node];
+
+	_nodeChildren.resize(numNodes > 0 ? numNodes - 1 : 0);
+
+	next.assign(_nodeChildrenBegin.begin(), _nodeChildrenBegin.end() - 1);
+	std::vector<bool> seen(numNodes, false);
+	for (unsigned int pixel = 0; pixel < size; pixel++) {
+
+		unsigned int node = nodeOf[pixel];
+
+		if (seen[node])
+			continue;
+		seen[node] = true;
+
+		if (node != _rootNode)
+			_nodeChildren[next[_nodeParent[node]]++] = node;
+	}
+
+	_nodeReported.assign(numNodes, true);
+
+	if (!_parameters.spacedEdgeImage)
+		return;
+
+	// Find the nodes without condensed pixels, and the nodes that have the 
+	// same condensed pixels as their only non-empty child. The nodes are 
+	// processed in reverse breadth first order, i.e., children before their 
+	// parents.
+
+	std::vector<unsigned int> order;
+	order.reserve(numNodes);
+	order.push_back(_rootNode);
+	for (unsigned int i = 0; i < order.size(); i++)
+		order.insert(
+				order.end(),
+				_nodeChildren.begin() + _nodeChildrenBegin[order[i]],
+				_nodeChildren.begin() + _nodeChildrenBegin[order[i] + 1]);
+
+	// the number of condensed pixels in the subtree of each node
+	std::vector<unsigned int> subtreeSize(numNodes);
+
+	for (unsigned int i = numNodes; i-- > 0;) {
+
+		unsigned int node        = order[i];
+		unsigned int ownSize     = _nodePixelsBegin[node + 1] - _nodePixelsBegin[node];
+		unsigned int numNonEmpty = 0;
+
+		subtreeSize[node] = ownSize;
+
+		for (unsigned int c = _nodeChildrenBegin[node]; c < _nodeChildrenBegin[node + 1]; c++) {
+
+			unsigned int childSize = subtreeSize[_nodeChildren[c]];
+
+			subtreeSize[node] += childSize;
+			if (childSize > 0)
+				numNonEmpty++;
+		}
+
+		if (subtreeSize[node] == 0 || (ownSize == 0 && numNonEmpty == 1))
+			_nodeReported[node] = false;
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::countNodes(unsigned int begin, unsigned int end) {
+
+	const Precision* levels = _image.data();
+
+	unsigned int numNodes = 0;
+	for (unsigned int pixel = begin; pixel < end; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent == pixel || levels[parent] != levels[pixel])
+			numNodes++;
+	}
+
+	_tileNodes[getTile(begin) + 1] = numNodes;
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::createNodes(unsigned int begin, unsigned int end) {
+
+	const Precision* levels = _image.data();
+	std::vector<unsigned int>& nodeOf = _zpar;
+
+	unsigned int node = _tileNodes[getTile(begin)];
+	for (unsigned int pixel = begin; pixel < end; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent != pixel && levels[parent] == levels[pixel])
+			continue;
+
+		nodeOf[pixel]    = node;
+		_nodeLevel[node] = levels[pixel];
+		node++;
+	}
+}
+
+template <typename Precision, typename ImageType>
+void
+UnionFindParser<Precision, ImageType>::linkNodes(unsigned int begin, unsigned int end) {
+
+	const Precision* levels = _image.data();
+	std::vector<unsigned int>& nodeOf = _zpar;
+
+	// the parents of all pixels are canonical, and the nodes of canonical 
+	// pixels are not changed here
+	for (unsigned int pixel = begin; pixel < end; pixel++) {
+
+		unsigned int parent = _parent[pixel];
+
+		if (parent == pixel) {
+
+			_rootNode = nodeOf[pixel];
+			_nodeParent[_rootNode] = _rootNode;
+
+		} else if (levels[parent] != levels[pixel]) {
+
+			_nodeParent[nodeOf[pixel]] = nodeOf[parent];
+
+		} else {
+
+			nodeOf[pixel] = nodeOf[parent];
+		}
+	}
+}
+
+#endif // IMAGEPROCESSING_UNION_FIND_PARSER_H__
+
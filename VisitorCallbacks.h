@@ -0,0 +1,306 @@
+#ifndef IMAGEPROCESSING_VISITOR_CALLBACKS_H__
+#define IMAGEPROCESSING_VISITOR_CALLBACKS_H__
+
+#include <type_traits>
+#include <utility>
+
+#include "PixelList.h"
+#include "ComponentAttributes.h"
+
+namespace visitor_callbacks_detail {
+
+	/**
+	 * Detects visitors with a method newChildComponent(value).
+	 */
+	template <typename VisitorType, typename ValueType>
+	class HasNewChildComponent {
+
+		template <typename V>
+		static std::true_type test(decltype(std::declval<V&>().newChildComponent(std::declval<ValueType>()))*);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors that inherit newChildComponent from the given base
+	 * visitor, instead of implementing it themselves. If the method can not
+	 * be identified (e.g., because it is overloaded), it is assumed to be
+	 * implemented by the visitor.
+	 */
+	template <typename VisitorType, typename BaseVisitorType>
+	class InheritsNewChildComponent {
+
+		template <typename V>
+		static std::is_same<decltype(&V::newChildComponent), decltype(&BaseVisitorType::newChildComponent)> test(int);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors that inherit finalizeComponent from the given base
+	 * visitor (see InheritsNewChildComponent).
+	 */
+	template <typename VisitorType, typename BaseVisitorType>
+	class InheritsFinalizeComponent {
+
+		template <typename V>
+		static std::is_same<decltype(&V::finalizeComponent), decltype(&BaseVisitorType::finalizeComponent)> test(int);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors with a method newChildLevel(level).
+	 */
+	template <typename VisitorType, typename Precision>
+	class HasNewChildLevel {
+
+		template <typename V>
+		static std::true_type test(decltype(std::declval<V&>().newChildLevel(std::declval<Precision>()))*);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors with a method finalizeLevel(level, begin, end).
+	 */
+	template <typename VisitorType, typename Precision, typename IteratorType>
+	class HasFinalizeLevel {
+
+		template <typename V>
+		static std::true_type test(
+				decltype(std::declval<V&>().finalizeLevel(
+						std::declval<Precision>(),
+						std::declval<IteratorType>(),
+						std::declval<IteratorType>()))*);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors with a method finalizeLevel(level, begin, end,
+	 * attributes).
+	 */
+	template <typename VisitorType, typename Precision, typename IteratorType>
+	class HasFinalizeLevelWithAttributes {
+
+		template <typename V>
+		static std::true_type test(
+				decltype(std::declval<V&>().finalizeLevel(
+						std::declval<Precision>(),
+						std::declval<IteratorType>(),
+						std::declval<IteratorType>(),
+						std::declval<const ComponentAttributes&>()))*);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+
+	/**
+	 * Detects visitors with a method finalizeComponent(value, begin, end,
+	 * attributes).
+	 */
+	template <typename VisitorType, typename ValueType, typename IteratorType>
+	class HasFinalizeComponentWithAttributes {
+
+		template <typename V>
+		static std::true_type test(
+				decltype(std::declval<V&>().finalizeComponent(
+						std::declval<ValueType>(),
+						std::declval<IteratorType>(),
+						std::declval<IteratorType>(),
+						std::declval<const ComponentAttributes&>()))*);
+
+		template <typename V>
+		static std::false_type test(...);
+
+	public:
+
+		static const bool value = decltype(test<VisitorType>(0))::value;
+	};
+}
+
+/**
+ * Invokes the callbacks of a parser visitor, depending on which callbacks the
+ * visitor implements. This is decided at compile time, such that callbacks
+ * that are not implemented are not invoked at all, and the original values
+ * of the levels are only computed if needed:
+ *
+ * When entering a component, newChildLevel(level) is invoked if the visitor
+ * has it. Otherwise, newChildComponent(value) is invoked, unless the visitor
+ * just inherits the no-op of BaseVisitorType or does not have it at all.
+ *
+ * When finalizing a component, finalizeLevel(level, begin, end) is invoked if
+ * the visitor has it, otherwise finalizeComponent(value, begin, end) (again,
+ * unless it is the no-op of BaseVisitorType). Both can also take the
+ * attributes of the component as a fourth argument, in which case the parser
+ * has to accumulate them.
+ *
+ * The level callbacks receive the discretized levels of the parser, which are
+ * cheaper to obtain than the original values and exact.
+ */
+template <
+		typename VisitorType,
+		typename BaseVisitorType,
+		typename Precision,
+		typename ValueType,
+		typename IteratorType = PixelList::const_iterator>
+class VisitorCallbacks {
+
+	typedef visitor_callbacks_detail::HasFinalizeLevel<VisitorType, Precision, IteratorType>                     HasFinalizeLevel;
+	typedef visitor_callbacks_detail::HasFinalizeLevelWithAttributes<VisitorType, Precision, IteratorType>       HasFinalizeLevelWithAttributes;
+	typedef visitor_callbacks_detail::HasFinalizeComponentWithAttributes<VisitorType, ValueType, IteratorType>   HasFinalizeComponentWithAttributes;
+
+public:
+
+	/**
+	 * The visitor wants to know about new child components by their level.
+	 */
+	static const bool NewChildLevel = visitor_callbacks_detail::HasNewChildLevel<VisitorType, Precision>::value;
+
+	/**
+	 * The visitor wants to know about new child components by their value.
+	 */
+	static const bool NewChildComponent =
+			!NewChildLevel &&
+			visitor_callbacks_detail::HasNewChildComponent<VisitorType, ValueType>::value &&
+			!visitor_callbacks_detail::InheritsNewChildComponent<VisitorType, BaseVisitorType>::value;
+
+	/**
+	 * The visitor wants finalized components by their level.
+	 */
+	static const bool FinalizeLevel = HasFinalizeLevel::value || HasFinalizeLevelWithAttributes::value;
+
+	/**
+	 * The visitor wants finalized components by their value.
+	 */
+	static const bool FinalizeComponent =
+			!FinalizeLevel &&
+			!visitor_callbacks_detail::InheritsFinalizeComponent<VisitorType, BaseVisitorType>::value;
+
+	/**
+	 * The visitor wants the attributes of finalized components.
+	 */
+	static const bool AcceptsAttributes =
+			(FinalizeLevel ?
+			 HasFinalizeLevelWithAttributes::value :
+			 FinalizeComponent && HasFinalizeComponentWithAttributes::value);
+
+	/**
+	 * Notify the visitor about a new child component with the given level,
+	 * if it wants to know.
+	 */
+	template <typename DiscretizerType>
+	static inline void newChild(VisitorType& visitor, Precision level, const DiscretizerType& discretizer) {
+
+		newChild(visitor, level, discretizer, std::integral_constant<int, NewChildLevel ? 2 : (NewChildComponent ? 1 : 0)>());
+	}
+
+	/**
+	 * Pass a finalized component with the given level to the visitor, with or
+	 * without its attributes, depending on what the visitor accepts.
+	 */
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType&               visitor,
+			Precision                  level,
+			const DiscretizerType&     discretizer,
+			IteratorType               begin,
+			IteratorType               end,
+			const ComponentAttributes& attributes) {
+
+		finalize(
+				visitor, level, discretizer, begin, end, attributes,
+				std::integral_constant<int, (FinalizeLevel ? 2 : (FinalizeComponent ? 1 : 0)) + (AcceptsAttributes ? 3 : 0)>());
+	}
+
+private:
+
+	template <typename DiscretizerType>
+	static inline void newChild(VisitorType&, Precision, const DiscretizerType&, std::integral_constant<int, 0>) {}
+
+	template <typename DiscretizerType>
+	static inline void newChild(VisitorType& visitor, Precision level, const DiscretizerType& discretizer, std::integral_constant<int, 1>) {
+
+		visitor.newChildComponent(discretizer.getOriginalValue(level));
+	}
+
+	template <typename DiscretizerType>
+	static inline void newChild(VisitorType& visitor, Precision level, const DiscretizerType&, std::integral_constant<int, 2>) {
+
+		visitor.newChildLevel(level);
+	}
+
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType&, Precision, const DiscretizerType&,
+			IteratorType, IteratorType, const ComponentAttributes&,
+			std::integral_constant<int, 0>) {}
+
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType& visitor, Precision level, const DiscretizerType& discretizer,
+			IteratorType begin, IteratorType end, const ComponentAttributes&,
+			std::integral_constant<int, 1>) {
+
+		visitor.finalizeComponent(discretizer.getOriginalValue(level), begin, end);
+	}
+
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType& visitor, Precision level, const DiscretizerType&,
+			IteratorType begin, IteratorType end, const ComponentAttributes&,
+			std::integral_constant<int, 2>) {
+
+		visitor.finalizeLevel(level, begin, end);
+	}
+
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType& visitor, Precision level, const DiscretizerType& discretizer,
+			IteratorType begin, IteratorType end, const ComponentAttributes& attributes,
+			std::integral_constant<int, 4>) {
+
+		visitor.finalizeComponent(discretizer.getOriginalValue(level), begin, end, attributes);
+	}
+
+	template <typename DiscretizerType>
+	static inline void finalize(
+			VisitorType& visitor, Precision level, const DiscretizerType&,
+			IteratorType begin, IteratorType end, const ComponentAttributes& attributes,
+			std::integral_constant<int, 5>) {
+
+		visitor.finalizeLevel(level, begin, end, attributes);
+	}
+};
+
+#endif // IMAGEPROCESSING_VISITOR_CALLBACKS_H__
@@ -0,0 +1,3 @@
+#include "VolumeLevelParser.h"
+
+logger::LogChannel volumelevelparserlog("volumelevelparserlog", "[VolumeLevelParser] ");
@@ -0,0 +1,345 @@
+#ifndef IMAGEPROCESSING_VOLUME_LEVEL_PARSER_H__
+#define IMAGEPROCESSING_VOLUME_LEVEL_PARSER_H__
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include <util/Logger.h>
+#include "VoxelList.h"
+#include "ExplicitVolume.h"
+#include "ImageDiscretizer.h"
+#include "FloodingLevelParser.h"
+#include "VisitorCallbacks.h"
+#include "exceptions.h"
+
+extern logger::LogChannel volumelevelparserlog;
+
+/**
+ * The volumetric counterpart of ImageLevelParser: Parses the voxels of a
+ * volume in terms of the connected components of varying intensity thresholds
+ * in linear time, using 6- or 26-connectivity. For each connected component
+ * and each threshold value, a user specified callback is invoked.
+ *
+ * The flooding algorithm is the same as for ImageLevelParser (see
+ * FloodingLevelParser), this class only sets up the padded volume and fills
+ * the voxel list. Components span all sections of the volume, such that no
+ * matching of the components of individual sections is needed.
+ */
+template <typename Precision = unsigned char, typename VolumeType = ExplicitVolume<float>, int Connectivity = 6>
+class VolumeLevelParser : public FloodingLevelParser<VolumeLevelParser<Precision, VolumeType, Connectivity>, Precision, typename VolumeType::data_type, VoxelList, Connectivity> {
+
+	static_assert(Connectivity == 6 || Connectivity == 26, "only 6- and 26-connectivity are supported");
+
+	typedef FloodingLevelParser<VolumeLevelParser<Precision, VolumeType, Connectivity>, Precision, typename VolumeType::data_type, VoxelList, Connectivity> Flooding;
+
+	friend Flooding;
+
+public:
+
+	typedef typename VolumeType::value_type value_type;
+
+	/**
+	 * Parameters of the volume level parser. See ImageLevelParser::Parameters.
+	 */
+	struct Parameters {
+
+		Parameters() : darkToBright(true), minIntensity(0), maxIntensity(0), skipEmptyLevels(false), rankTransform(false), quantiles(false) {}
+
+		// start processing the dark regions
+		bool darkToBright;
+
+		/**
+		 * The min and max intensity of the volume, used for discretization
+		 * into the Precision type. If both are 0, the volume is inspected to
+		 * find them.
+		 */
+		value_type minIntensity;
+		value_type maxIntensity;
+
+		/**
+		 * Only begin and end components at levels that are actually present
+		 * in the (discretized) volume.
+		 */
+		bool skipEmptyLevels;
+
+		/**
+		 * Use the ranks of the distinct intensities of the volume as levels. 
+		 * Implies skipEmptyLevels.
+		 */
+		bool rankTransform;
+
+		/**
+		 * Discretize the intensities such that each level receives about the 
+		 * same number of voxels.
+		 */
+		bool quantiles;
+	};
+
+	/**
+	 * Base class and interface definition of visitors that are accepted by the
+	 * parse methods. Same as ImageLevelParser::Visitor, but with voxel lists.
+	 */
+	class Visitor {
+
+	public:
+
+		/**
+		 * Invoked whenever a new component is added as a child of the current
+		 * component, starting from the root (the whole volume component) in a
+		 * depth first manner.
+		 */
+		void newChildComponent(value_type /*value*/) {}
+
+		/**
+		 * Set the voxel list that contains the voxel locations of each
+		 * component. The iterators passed by finalizeComponent refer to
+		 * indices in this voxel list.
+		 */
+		void setPixelList(boost::shared_ptr<VoxelList> voxelList) {}
+
+		/**
+		 * Invoked whenever the current component was extracted entirely.
+		 */
+		void finalizeComponent(
+				value_type                value,
+				VoxelList::const_iterator begin,
+				VoxelList::const_iterator end) {}
+	};
+
+	/**
+	 * Create a new volume level parser for the given volume with the given
+	 * parameters.
+	 */
+	VolumeLevelParser(const VolumeType& volume, const Parameters& parameters = Parameters());
+
+	/**
+	 * Prepare this parser for parsing another volume, optionally with
+	 * different parameters. The voxel list is only reused if no visitor holds
+	 * on to it anymore and the new volume has the same shape.
+	 */
+	void reset(const VolumeType& volume);
+	void reset(const VolumeType& volume, const Parameters& parameters);
+
+	/**
+	 * Parse the volume. The provided visitor has to implement the interface
+	 * of Visitor (but does not need to inherit from it). Instead of
+	 * newChildComponent and finalizeComponent, the visitor can implement
+	 * newChildLevel(level) and finalizeLevel(level, begin, end) to receive
+	 * the discretized levels (see VisitorCallbacks).
+	 */
+	template <typename VisitorType>
+	void parse(VisitorType& visitor);
+
+private:
+
+	typedef typename Flooding::location_type location_type;
+
+	using Flooding::MaxValue;
+	using Flooding::Unvisited;
+	using Flooding::Border;
+	using Flooding::_discretizer;
+	using Flooding::_paddedLevels;
+	using Flooding::_state;
+	using Flooding::_neighborOffsets;
+	using Flooding::_levels;
+	using Flooding::_skipEmptyLevels;
+
+	/**
+	 * Copy the discretized volume into the padded volume and initialize the
+	 * state of each location.
+	 */
+	void padVolume();
+
+	/**
+	 * Collect the sorted list of levels that are present in the discretized
+	 * volume.
+	 */
+	void collectLevels();
+
+	/**
+	 * Add the voxel at the given location to the voxel list (see
+	 * FloodingLevelParser).
+	 */
+	void addLocation(location_type location) {
+
+		// the index of the location in a volume of the padded strides without
+		// border
+		_voxelList->addIndex(location - _strideZ - _strideY - 1);
+	}
+
+	/**
+	 * The voxel list that is passed to the visitor (see FloodingLevelParser).
+	 */
+	const VoxelList& reportedList() const { return *_voxelList; }
+
+	// discretized version of the input volume
+	vigra::MultiArray<3, Precision> _volume;
+
+	Parameters _parameters;
+
+	// the voxel list, shared ownership with visitors
+	boost::shared_ptr<VoxelList> _voxelList;
+
+	// the strides of a padded row and section of the padded volume, which
+	// stores the discretized volume with a border of one voxel (the neighbor
+	// offsets are the face neighbors first)
+	unsigned int _strideY;
+	unsigned int _strideZ;
+};
+
+template <typename Precision, typename VolumeType, int Connectivity>
+VolumeLevelParser<Precision, VolumeType, Connectivity>::VolumeLevelParser(const VolumeType& volume, const Parameters& parameters) :
+	Flooding(volumelevelparserlog),
+	_parameters(parameters) {
+
+	reset(volume, parameters);
+}
+
+template <typename Precision, typename VolumeType, int Connectivity>
+void
+VolumeLevelParser<Precision, VolumeType, Connectivity>::reset(const VolumeType& volume) {
+
+	reset(volume, _parameters);
+}
+
+template <typename Precision, typename VolumeType, int Connectivity>
+void
+VolumeLevelParser<Precision, VolumeType, Connectivity>::reset(const VolumeType& volume, const Parameters& parameters) {
+
+	LOG_ALL(volumelevelparserlog)
+			<< "initializing for volume of size "
+			<< volume.width() << "x" << volume.height() << "x" << volume.depth() << std::endl;
+
+	// locations in the padded volume have to fit into location_type
+	size_t paddedSize = static_cast<size_t>(volume.width() + 2)*(volume.height() + 2)*(volume.depth() + 2);
+	if (paddedSize > std::numeric_limits<location_type>::max())
+		UTIL_THROW_EXCEPTION(
+				InvalidOperation,
+				"volume of size " << volume.width() << "x" << volume.height() << "x" << volume.depth() <<
+				" is too large for VolumeLevelParser");
+
+	bool sameShape = (_voxelList && volume.data().shape() == _volume.shape());
+
+	_parameters  = parameters;
+	_discretizer = ImageDiscretizer<Precision, typename VolumeType::data_type>(
+			parameters.darkToBright,
+			parameters.minIntensity,
+			parameters.maxIntensity,
+			parameters.rankTransform,
+			parameters.quantiles);
+
+	// levels above the highest rank are empty
+	if (_parameters.rankTransform)
+		_parameters.skipEmptyLevels = true;
+
+	_strideY = volume.width() + 2;
+	_strideZ = _strideY*(volume.height() + 2);
+
+	// the voxel list stores linear indices with the strides of the padded
+	// volume
+	if (sameShape && _voxelList.unique())
+		_voxelList->clear();
+	else
+		_voxelList = boost::make_shared<VoxelList>(volume.data().size(), _strideY, volume.height() + 2);
+
+	_discretizer.discretize(volume.data(), _volume);
+	padVolume();
+
+	this->clearFlooding();
+
+	_skipEmptyLevels = _parameters.skipEmptyLevels;
+
+	if (_skipEmptyLevels)
+		collectLevels();
+	else
+		_levels.clear();
+}
+
+template <typename Precision, typename VolumeType, int Connectivity>
+void
+VolumeLevelParser<Precision, VolumeType, Connectivity>::padVolume() {
+
+	const unsigned int width  = _volume.shape(0);
+	const unsigned int height = _volume.shape(1);
+	const unsigned int depth  = _volume.shape(2);
+
+	_paddedLevels.resize(static_cast<size_t>(_strideZ)*(depth + 2));
+	_state.assign(_paddedLevels.size(), Border);
+
+	for (unsigned int z = 0; z < depth; z++)
+		for (unsigned int y = 0; y < height; y++) {
+
+			size_t row = static_cast<size_t>(z + 1)*_strideZ + static_cast<size_t>(y + 1)*_strideY + 1;
+
+			std::copy(
+					_volume.data() + (static_cast<size_t>(z)*height + y)*width,
+					_volume.data() + (static_cast<size_t>(z)*height + y + 1)*width,
+					_paddedLevels.begin() + row);
+			std::fill(
+					_state.begin() + row,
+					_state.begin() + row + width,
+					Unvisited);
+		}
+
+	// the 6 face neighbors, followed by the 12 edge and 8 corner neighbors
+	int numOffsets = 0;
+	for (int numNonZero = 1; numNonZero <= (Connectivity == 6 ? 1 : 3); numNonZero++)
+		for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+				for (int dx = -1; dx <= 1; dx++)
+					if ((dx != 0) + (dy != 0) + (dz != 0) == numNonZero)
+						_neighborOffsets[numOffsets++] =
+								dz*static_cast<int>(_strideZ) +
+								dy*static_cast<int>(_strideY) +
+								dx;
+}
+
+template <typename Precision, typename VolumeType, int Connectivity>
+void
+VolumeLevelParser<Precision, VolumeType, Connectivity>::collectLevels() {
+
+	// after a rank transform, all levels up to the number of ranks are 
+	// present
+	if (_discretizer.getNumRanks() > 0) {
+
+		_levels.resize(_discretizer.getNumRanks());
+		for (size_t level = 0; level < _levels.size(); level++)
+			_levels[level] = level;
+
+		return;
+	}
+
+	_levels.assign(_volume.begin(), _volume.end());
+	std::sort(_levels.begin(), _levels.end());
+	_levels.erase(std::unique(_levels.begin(), _levels.end()), _levels.end());
+
+	LOG_DEBUG(volumelevelparserlog)
+			<< "volume contains " << _levels.size() << " distinct levels" << std::endl;
+}
+
+template <typename Precision, typename VolumeType, int Connectivity>
+template <typename VisitorType>
+void
+VolumeLevelParser<Precision, VolumeType, Connectivity>::parse(VisitorType& visitor) {
+
+	static_assert(
+			!VisitorCallbacks<VisitorType, Visitor, Precision, value_type, VoxelList::const_iterator>::AcceptsAttributes,
+			"VolumeLevelParser does not accumulate component attributes");
+
+	LOG_ALL(volumelevelparserlog) << "parsing volume" << std::endl;
+
+	visitor.setPixelList(_voxelList);
+
+	if (_volume.size() == 0)
+		return;
+
+	// start at the first voxel of the volume
+	this->flood(_strideZ + _strideY + 1, visitor);
+}
+
+#endif // IMAGEPROCESSING_VOLUME_LEVEL_PARSER_H__
+
@@ -0,0 +1,165 @@
+#ifndef IMAGEPROCESSING_VOXEL_LIST_H__
+#define IMAGEPROCESSING_VOXEL_LIST_H__
+
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <util/point.hpp>
+
+/**
+ * A list of voxel locations, the volumetric counterpart of a compact
+ * PixelList. Each voxel is stored as a single 32-bit linear index
+ * (z*height + y)*width + x, and iterators decode the voxel locations on
+ * access. As for PixelList, width and height only have to be larger than all
+ * x and y coordinates, i.e., they can also be the strides of a padded volume.
+ * As long as the initially set size is not exceeded, adding voxels and
+ * clearing does not invalidate iterators into the list.
+ */
+class VoxelList {
+
+	typedef std::vector<unsigned int> voxel_list_type;
+
+public:
+
+	typedef util::point<unsigned int,3> value_type;
+
+	class const_iterator {
+
+	public:
+
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef VoxelList::value_type           value_type;
+		typedef std::ptrdiff_t                  difference_type;
+		typedef value_type                      reference;
+
+		/**
+		 * Helper to support operator-> on decoded voxel locations.
+		 */
+		class pointer {
+
+		public:
+
+			pointer(const value_type& voxel) : _voxel(voxel) {}
+
+			const value_type* operator->() const { return &_voxel; }
+
+		private:
+
+			value_type _voxel;
+		};
+
+		const_iterator() : _pos(0), _width(0), _height(0) {}
+
+		const_iterator(const unsigned int* pos, unsigned int width, unsigned int height) :
+			_pos(pos),
+			_width(width),
+			_height(height) {}
+
+		value_type operator*() const {
+
+			unsigned int xy = *_pos % (_width*_height);
+
+			return value_type(xy % _width, xy / _width, *_pos / (_width*_height));
+		}
+
+		pointer    operator->() const { return pointer(**this); }
+		value_type operator[](difference_type n) const { return *(*this + n); }
+
+		const_iterator& operator++() { _pos++; return *this; }
+		const_iterator& operator--() { _pos--; return *this; }
+		const_iterator  operator++(int) { const_iterator i = *this; ++(*this); return i; }
+		const_iterator  operator--(int) { const_iterator i = *this; --(*this); return i; }
+
+		const_iterator& operator+=(difference_type n) { _pos += n; return *this; }
+		const_iterator& operator-=(difference_type n) { _pos -= n; return *this; }
+		const_iterator  operator+(difference_type n) const { const_iterator i = *this; return i += n; }
+		const_iterator  operator-(difference_type n) const { const_iterator i = *this; return i -= n; }
+
+		difference_type operator-(const const_iterator& other) const { return _pos - other._pos; }
+
+		bool operator==(const const_iterator& other) const { return _pos == other._pos; }
+		bool operator!=(const const_iterator& other) const { return _pos != other._pos; }
+		bool operator< (const const_iterator& other) const { return _pos <  other._pos; }
+		bool operator> (const const_iterator& other) const { return _pos >  other._pos; }
+		bool operator<=(const const_iterator& other) const { return _pos <= other._pos; }
+		bool operator>=(const const_iterator& other) const { return _pos >= other._pos; }
+
+		/**
+		 * Direct access to the linear index of the current voxel.
+		 */
+		const unsigned int* data() const { return _pos; }
+
+	private:
+
+		const unsigned int* _pos;
+		unsigned int        _width;
+		unsigned int        _height;
+	};
+
+	// voxel lists can not be modified through iterators
+	typedef const_iterator iterator;
+
+	VoxelList() : _width(0), _height(0) {}
+
+	/**
+	 * Create a new voxel list of the given size for voxels of a volume with
+	 * the given width and height.
+	 */
+	VoxelList(size_t size, unsigned int width, unsigned int height) :
+		_width(width),
+		_height(height) {
+
+		_voxelList.reserve(size);
+	}
+
+	/**
+	 * Add a voxel to the voxel list. Existing iterators are not invalidated,
+	 * as long as 'size' is not exceeded.
+	 */
+	void add(const util::point<unsigned int,3>& voxel) {
+
+		_voxelList.push_back((voxel.z()*_height + voxel.y())*_width + voxel.x());
+	}
+
+	/**
+	 * Add a voxel given by its linear index (z*height + y)*width + x.
+	 */
+	void addIndex(unsigned int index) {
+
+		_voxelList.push_back(index);
+	}
+
+	/**
+	 * Remove all voxels from the voxel list, keeping its allocated size.
+	 */
+	void clear() { _voxelList.clear(); }
+
+	/**
+	 * Iterator access.
+	 */
+	const_iterator begin() const { return const_iterator(_voxelList.data(), _width, _height); }
+	const_iterator end() const { return const_iterator(_voxelList.data() + _voxelList.size(), _width, _height); }
+
+	/**
+	 * The number of voxels that have been added to this voxel list.
+	 */
+	size_t size() const { return _voxelList.size(); }
+
+	/**
+	 * The width and height of the volume the linear indices refer to.
+	 */
+	unsigned int getWidth()  const { return _width; }
+	unsigned int getHeight() const { return _height; }
+
+private:
+
+	// a non-resizing vector of linear indices
+	voxel_list_type _voxelList;
+
+	// the width and height of the volume
+	unsigned int _width;
+	unsigned int _height;
+};
+
+#endif // IMAGEPROCESSING_VOXEL_LIST_H__
+
@@ -0,0 +1,246 @@
+#include <ctime>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <util/Logger.h>
+#include <util/exceptions.h>
+#include "ComponentTreeCache.h"
+#include "ComponentTreeFile.h"
+
+logger::LogChannel componenttreecachelog("componenttreecachelog", "[ComponentTreeCache] ");
+
+namespace {
+
+// the hit and miss counters of all caches
+boost::mutex counterMutex;
+size_t       hits   = 0;
+size_t       misses = 0;
+
+void count(size_t& counter) {
+
+	boost::mutex::scoped_lock lock(counterMutex);
+	counter++;
+}
+
+/**
+ * MurmurHash64A, seeded with the hash of the previous data.
+ */
+uint64_t murmurHash(const void* data, size_t size, uint64_t seed) {
+
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int      r = 47;
+
+	uint64_t h = seed ^ (size*m);
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	const unsigned char* end   = bytes + size/8*8;
+
+	for (; bytes != end; bytes += 8) {
+
+		uint64_t k;
+		std::memcpy(&k, bytes, 8);
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	// the remaining bytes
+	const size_t tail = size & 7;
+
+	for (size_t i = 0; i < tail; i++)
+		h ^= uint64_t(bytes[i]) << (8*i);
+
+	if (tail > 0)
+		h *= m;
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
+
+struct CacheFile {
+
+	boost::filesystem::path path;
+	std::time_t             lastUse;
+	uintmax_t               size;
+
+	// modification times have a resolution of one second, break ties by name
+	// to evict in the same order in all processes
+	bool operator<(const CacheFile& other) const {
+
+		if (lastUse != other.lastUse)
+			return lastUse < other.lastUse;
+
+		return path < other.path;
+	}
+};
+
+} // anonymous namespace
+
+ComponentTreeCache::Hasher::Hasher() :
+	// the version of the cache, change to invalidate existing caches
+	_hash(1) {}
+
+void
+ComponentTreeCache::Hasher::add(const void* data, size_t size) {
+
+	_hash = murmurHash(data, size, _hash);
+}
+
+ComponentTreeCache::ComponentTreeCache(const std::string& directory, size_t maxSize) :
+	_directory(directory),
+	_maxSize(maxSize) {
+
+	boost::filesystem::create_directories(_directory);
+}
+
+boost::shared_ptr<FlatComponentTree>
+ComponentTreeCache::get(key_type key) {
+
+	const std::string filename = getFilename(key);
+
+	boost::shared_ptr<FlatComponentTree> tree;
+
+	if (boost::filesystem::exists(filename)) {
+
+		try {
+
+			tree = ComponentTreeFile::read(filename);
+
+			// mark as recently used
+			boost::system::error_code error;
+			boost::filesystem::last_write_time(filename, std::time(0), error);
+
+		} catch (IOError& e) {
+
+			// the file was removed by another process, or is invalid
+			LOG_ERROR(componenttreecachelog)
+					<< "can not read cached tree " << filename << std::endl;
+		}
+	}
+
+	if (tree) {
+
+		count(hits);
+		LOG_DEBUG(componenttreecachelog) << "cache hit for " << filename << std::endl;
+
+	} else {
+
+		count(misses);
+		LOG_DEBUG(componenttreecachelog) << "cache miss for " << filename << std::endl;
+	}
+
+	return tree;
+}
+
+void
+ComponentTreeCache::put(key_type key, const FlatComponentTree& tree) {
+
+	const boost::filesystem::path filename = getFilename(key);
+	const boost::filesystem::path tmp =
+			boost::filesystem::path(_directory) /
+			boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tmp");
+
+	LOG_DEBUG(componenttreecachelog) << "storing " << filename << std::endl;
+
+	try {
+
+		ComponentTreeFile::write(tree, tmp.string());
+		boost::filesystem::rename(tmp, filename);
+
+	} catch (...) {
+
+		boost::system::error_code error;
+		boost::filesystem::remove(tmp, error);
+		throw;
+	}
+
+	if (_maxSize > 0)
+		evict(filename);
+}
+
+size_t
+ComponentTreeCache::getHits() {
+
+	boost::mutex::scoped_lock lock(counterMutex);
+	return hits;
+}
+
+size_t
+ComponentTreeCache::getMisses() {
+
+	boost::mutex::scoped_lock lock(counterMutex);
+	return misses;
+}
+
+void
+ComponentTreeCache::resetCounters() {
+
+	boost::mutex::scoped_lock lock(counterMutex);
+	hits   = 0;
+	misses = 0;
+}
+
+std::string
+ComponentTreeCache::getFilename(key_type key) const {
+
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << ".ctree";
+
+	return (boost::filesystem::path(_directory) / name.str()).string();
+}
+
+void
+ComponentTreeCache::evict(const boost::filesystem::path& keep) {
+
+	std::vector<CacheFile> files;
+	uintmax_t              totalSize = 0;
+
+	// other processes might remove files at the same time, ignore errors
+	boost::system::error_code error;
+
+	for (boost::filesystem::directory_iterator i(_directory); i != boost::filesystem::directory_iterator(); i++) {
+
+		if (i->path().extension() != ".ctree")
+			continue;
+
+		CacheFile file;
+		file.path    = i->path();
+		file.lastUse = boost::filesystem::last_write_time(file.path, error);
+		file.size    = boost::filesystem::file_size(file.path, error);
+
+		if (error)
+			continue;
+
+		totalSize += file.size;
+
+		// never evict the tree that was just stored
+		if (file.path != keep)
+			files.push_back(file);
+	}
+
+	if (totalSize <= _maxSize)
+		return;
+
+	std::sort(files.begin(), files.end());
+
+	for (std::vector<CacheFile>::const_iterator i = files.begin(); i != files.end() && totalSize > _maxSize; i++) {
+
+		LOG_DEBUG(componenttreecachelog) << "evicting " << i->path << std::endl;
+
+		boost::filesystem::remove(i->path, error);
+		totalSize -= i->size;
+	}
+}
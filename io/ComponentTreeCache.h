@@ -0,0 +1,108 @@
+#ifndef IMAGEPROCESSING_IO_COMPONENT_TREE_CACHE_H__
+#define IMAGEPROCESSING_IO_COMPONENT_TREE_CACHE_H__
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <imageprocessing/FlatComponentTree.h>
+
+/**
+ * A persistent cache of component trees in a directory, shared between
+ * processes. Trees are identified by a key, which is a hash of everything
+ * the tree was extracted from (see Hasher), and stored in one
+ * ComponentTreeFile per key.
+ *
+ * If the cache is limited in size, the least recently used trees are removed
+ * after storing a new tree until the files fit into the limit. The new tree
+ * itself is always kept, even if it alone exceeds the limit. Files are
+ * written under a temporary name and renamed afterwards, such that
+ * concurrent readers never see incomplete trees.
+ */
+class ComponentTreeCache {
+
+public:
+
+	typedef uint64_t key_type;
+
+	/**
+	 * Creates keys from the data trees are extracted from, with a fast
+	 * non-cryptographic 64-bit hash.
+	 */
+	class Hasher {
+
+	public:
+
+		Hasher();
+
+		/**
+		 * Add the given bytes to the key.
+		 */
+		void add(const void* data, size_t size);
+
+		/**
+		 * Add the bytes of the given value to the key.
+		 */
+		template <typename T>
+		void add(const T& value) { add(&value, sizeof(T)); }
+
+		key_type getKey() const { return _hash; }
+
+	private:
+
+		uint64_t _hash;
+	};
+
+	/**
+	 * Create a cache in the given directory, which is created if it does not
+	 * exist.
+	 *
+	 * @param directory
+	 *              The directory to store the trees in.
+	 * @param maxSize
+	 *              The maximal number of bytes of all trees in the cache, or 0
+	 *              for no limit.
+	 */
+	ComponentTreeCache(const std::string& directory, size_t maxSize = 0);
+
+	/**
+	 * Get the tree for the given key.
+	 *
+	 * @return The tree (mapped from its file), or an empty pointer if the
+	 *         cache does not contain the key.
+	 */
+	boost::shared_ptr<FlatComponentTree> get(key_type key);
+
+	/**
+	 * Store the tree for the given key.
+	 */
+	void put(key_type key, const FlatComponentTree& tree);
+
+	/**
+	 * The number of successful and unsuccessful calls to get() of all caches
+	 * since the start of the program (or the last call to resetCounters()).
+	 */
+	static size_t getHits();
+	static size_t getMisses();
+
+	static void resetCounters();
+
+private:
+
+	std::string getFilename(key_type key) const;
+
+	/**
+	 * Remove the least recently used trees until the cache fits into its
+	 * maximal size. The given file is never removed.
+	 */
+	void evict(const boost::filesystem::path& keep);
+
+	std::string _directory;
+
+	size_t _maxSize;
+};
+
+#endif // IMAGEPROCESSING_IO_COMPONENT_TREE_CACHE_H__
+
@@ -0,0 +1,269 @@
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/make_shared.hpp>
+
+#include <util/Logger.h>
+#include <util/exceptions.h>
+#include "ComponentTreeFile.h"
+
+logger::LogChannel componenttreefilelog("componenttreefilelog", "[ComponentTreeFile] ");
+
+namespace {
+
+const char         Magic[8] = { 'C', 'T', 'R', 'E', 'E', 0, 0, 0 };
+const unsigned int Version  = 1;
+
+struct Header {
+
+	char     magic[8];
+	uint32_t version;
+	uint32_t width;
+	uint64_t numPixelWords;
+	uint64_t numNodes;
+	uint64_t numChildren;
+	uint64_t reserved[3];
+};
+
+static_assert(sizeof(Header) == 64, "unexpected size of component tree file header");
+static_assert(sizeof(util::box<int,2>) == 4*sizeof(int), "unexpected size of bounding boxes");
+static_assert(sizeof(util::point<double,2>) == 2*sizeof(double), "unexpected size of centers");
+
+/**
+ * The number of bytes of an array with the given number of elements,
+ * including the padding to the next multiple of 8.
+ */
+template <typename T>
+size_t paddedSize(size_t size) {
+
+	return (size*sizeof(T) + 7)/8*8;
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const T* data, size_t size) {
+
+	static const char padding[8] = { 0 };
+
+	out.write(reinterpret_cast<const char*>(data), size*sizeof(T));
+	out.write(padding, paddedSize<T>(size) - size*sizeof(T));
+}
+
+/**
+ * A read-only memory mapping of a file, unmapped on destruction.
+ */
+class MappedFile {
+
+public:
+
+	MappedFile(const std::string& filename) :
+		_data(0),
+		_size(0) {
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+
+		if (fd < 0)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"can not open " << filename << ": " << std::strerror(errno));
+
+		struct stat status;
+
+		if (::fstat(fd, &status) < 0) {
+
+			::close(fd);
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					"can not stat " << filename << ": " << std::strerror(errno));
+		}
+
+		_size = status.st_size;
+
+		if (_size > 0) {
+
+			void* data = ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (data == MAP_FAILED) {
+
+				::close(fd);
+				UTIL_THROW_EXCEPTION(
+						IOError,
+						"can not map " << filename << ": " << std::strerror(errno));
+			}
+
+			_data = static_cast<const char*>(data);
+		}
+
+		// the mapping stays valid after closing the file
+		::close(fd);
+	}
+
+	~MappedFile() {
+
+		if (_data)
+			::munmap(const_cast<char*>(_data), _size);
+	}
+
+	const char* data() const { return _data; }
+
+	size_t size() const { return _size; }
+
+private:
+
+	// non-copyable
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* _data;
+	size_t      _size;
+};
+
+} // anonymous namespace
+
+void
+ComponentTreeFile::write(const FlatComponentTree& tree, const std::string& filename) {
+
+	if (tree._childrenDirty)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"the children of the tree have to be updated before writing it to " << filename);
+
+	boost::shared_ptr<PixelList> pixelList = tree.getPixelList();
+
+	const unsigned int* pixels        = (pixelList ? pixelList->begin().data() : 0);
+	const size_t        numPixelWords = (pixelList ? pixelList->end().data() - pixels : 0);
+
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version       = Version;
+	header.width         = (pixelList ? pixelList->getWidth() : 0);
+	header.numPixelWords = numPixelWords;
+	header.numNodes      = tree.size();
+	header.numChildren   = tree._children.size();
+
+	LOG_DEBUG(componenttreefilelog)
+			<< "writing " << header.numNodes << " nodes and "
+			<< numPixelWords << " pixel words to " << filename << std::endl;
+
+	std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"can not create " << filename);
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+	writeArray(out, pixels, numPixelWords);
+	writeArray(out, tree._parents.data(), tree._parents.size());
+	writeArray(out, tree._childrenBegins.data(), tree._childrenBegins.size());
+	writeArray(out, tree._children.data(), tree._children.size());
+	writeArray(out, tree._pixelBegins.data(), tree._pixelBegins.size());
+	writeArray(out, tree._pixelEnds.data(), tree._pixelEnds.size());
+	writeArray(out, tree._values.data(), tree._values.size());
+	writeArray(out, tree._boundingBoxes.data(), tree._boundingBoxes.size());
+	writeArray(out, tree._centers.data(), tree._centers.size());
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"error writing " << filename);
+}
+
+void
+ComponentTreeFile::write(ComponentTree& tree, const std::string& filename) {
+
+	boost::shared_ptr<FlatComponentTree> flatTree = tree.getFlatTree();
+
+	if (!flatTree)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"only component trees that are given as flat trees can be written to " << filename);
+
+	write(*flatTree, filename);
+}
+
+boost::shared_ptr<FlatComponentTree>
+ComponentTreeFile::read(const std::string& filename) {
+
+	typedef FlatComponentTree::node_type node_type;
+
+	boost::shared_ptr<MappedFile> file = boost::make_shared<MappedFile>(filename);
+
+	if (file->size() < sizeof(Header))
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				filename << " is not a component tree file");
+
+	const Header& header = *reinterpret_cast<const Header*>(file->data());
+
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				filename << " is not a component tree file");
+
+	if (header.version != Version)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				filename << " has unsupported version " << header.version);
+
+	const size_t numNodes = header.numNodes;
+
+	const size_t expectedSize =
+			sizeof(Header) +
+			paddedSize<unsigned int>(header.numPixelWords) +
+			paddedSize<node_type>(numNodes) +
+			paddedSize<node_type>(numNodes + 1) +
+			paddedSize<node_type>(header.numChildren) +
+			2*paddedSize<unsigned int>(numNodes) +
+			paddedSize<std::array<char, 8> >(numNodes) +
+			paddedSize<util::box<int,2> >(numNodes) +
+			paddedSize<util::point<double,2> >(numNodes);
+
+	if (file->size() != expectedSize)
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				filename << " has " << file->size() << " bytes, expected " << expectedSize);
+
+	LOG_DEBUG(componenttreefilelog)
+			<< "mapped " << numNodes << " nodes and "
+			<< header.numPixelWords << " pixel words from " << filename << std::endl;
+
+	const char* pos = file->data() + sizeof(Header);
+
+	boost::shared_ptr<FlatComponentTree> tree = boost::make_shared<FlatComponentTree>();
+
+	tree->_pixelList = boost::make_shared<PixelList>(
+			reinterpret_cast<const unsigned int*>(pos),
+			header.numPixelWords,
+			header.width,
+			file);
+	pos += paddedSize<unsigned int>(header.numPixelWords);
+
+	tree->_parents.map(reinterpret_cast<const node_type*>(pos), numNodes);
+	pos += paddedSize<node_type>(numNodes);
+	tree->_childrenBegins.map(reinterpret_cast<const node_type*>(pos), numNodes + 1);
+	pos += paddedSize<node_type>(numNodes + 1);
+	tree->_children.map(reinterpret_cast<const node_type*>(pos), header.numChildren);
+	pos += paddedSize<node_type>(header.numChildren);
+	tree->_pixelBegins.map(reinterpret_cast<const unsigned int*>(pos), numNodes);
+	pos += paddedSize<unsigned int>(numNodes);
+	tree->_pixelEnds.map(reinterpret_cast<const unsigned int*>(pos), numNodes);
+	pos += paddedSize<unsigned int>(numNodes);
+	tree->_values.map(reinterpret_cast<const std::array<char, 8>*>(pos), numNodes);
+	pos += paddedSize<std::array<char, 8> >(numNodes);
+	tree->_boundingBoxes.map(reinterpret_cast<const util::box<int,2>*>(pos), numNodes);
+	pos += paddedSize<util::box<int,2> >(numNodes);
+	tree->_centers.map(reinterpret_cast<const util::point<double,2>*>(pos), numNodes);
+
+	tree->_childrenDirty = false;
+	tree->_storage       = file;
+
+	return tree;
+}
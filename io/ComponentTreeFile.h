@@ -0,0 +1,46 @@
+#ifndef IMAGEPROCESSING_IO_COMPONENT_TREE_FILE_H__
+#define IMAGEPROCESSING_IO_COMPONENT_TREE_FILE_H__
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+#include <imageprocessing/FlatComponentTree.h>
+#include <imageprocessing/ComponentTree.h>
+
+/**
+ * Reads and writes component trees in a binary file format that can be used
+ * without deserializing the nodes: The file starts with a 64 byte header,
+ * followed by the columns of a FlatComponentTree (the pixel list, the
+ * parents, the children, the pixel ranges, values, bounding boxes, and
+ * centers of the nodes), each aligned to 8 bytes. All numbers are stored in
+ * the native byte order.
+ *
+ * Files are read by mapping them into memory. The columns of the resulting
+ * tree and its pixel list refer to the mapped memory directly, which stays
+ * mapped as long as the tree or its pixel list exists.
+ */
+class ComponentTreeFile {
+
+public:
+
+	/**
+	 * Write a flat component tree to the given file. The children of the 
+	 * tree have to be up to date (see FlatComponentTree::updateChildren()).
+	 */
+	static void write(const FlatComponentTree& tree, const std::string& filename);
+
+	/**
+	 * Write a component tree to the given file. The component tree has to be
+	 * given as a flat tree (see ComponentTree::getFlatTree()).
+	 */
+	static void write(ComponentTree& tree, const std::string& filename);
+
+	/**
+	 * Map the given file into memory and create a read-only flat component
+	 * tree from it.
+	 */
+	static boost::shared_ptr<FlatComponentTree> read(const std::string& filename);
+};
+
+#endif // IMAGEPROCESSING_IO_COMPONENT_TREE_FILE_H__
+